@@ -1,19 +1,18 @@
 #include "BlockSimulator.h"
 
 #define DEFAULT_RANDOM_SITE_SELECTION true
+#define DEFAULT_EVENT_DRIVEN false
 #define DEFAULT_PRECUT false
 
 #define DEFAULT_SAMPLE_AVALANCHE_SIZES true
+#define DEFAULT_AVALANCHE_HISTOGRAM false
+#define DEFAULT_BINS_PER_OCTAVE 4
 
 #define DEFAULT_DEPOSITING_TYPE 0
 
 #define BLOCKSIM_PEEL_AVALANCHE 0
 #define BLOCKSIM_POWERLAW_AVALANCHE 1
 
-//  (1)  |  (2)  |  (3)  |  (4)  |  (5)  |  (6)  |
-//       |       |       |       |       | o     |
-//       |   o   | o   o | o     | o o   | o o   |
-// o o o | o o o | o o o | o o o | o o o | o o o |
 using namespace dataframe;
 using namespace dataframe::utils;
 
@@ -28,6 +27,10 @@ BlockSimulator::BlockSimulator(ExperimentParams &params, uint32_t) : Simulator(p
   precut = get<int>(params, "precut", DEFAULT_PRECUT);
 
   random_sites = get<int>(params, "random_sites", DEFAULT_RANDOM_SITE_SELECTION);
+  event_driven = get<int>(params, "event_driven", DEFAULT_EVENT_DRIVEN);
+  if (event_driven && !random_sites) {
+    throw std::invalid_argument("Event-driven dynamics require random site selection.");
+  }
 
   feedback_mode = get<int>(params, "feedback_mode");
   depositing_type = get<int>(params, "depositing_type", DEFAULT_DEPOSITING_TYPE);
@@ -38,43 +41,39 @@ BlockSimulator::BlockSimulator(ExperimentParams &params, uint32_t) : Simulator(p
     for (size_t i = 1; i < system_size-1; i++) {
       normalization += std::pow(i, -delta);
     }
+
+    // powerlaw_table[d] is the desorption probability of a site at distance d from the avalanche origin
+    powerlaw_table = std::vector<double>(system_size, 1.0);
+    for (size_t d = 1; d < system_size; d++) {
+      powerlaw_table[d] = powerlaw(d);
+    }
   }
 
-  if      (feedback_mode == 0)  feedback_strategy = std::vector<uint32_t>{1};
-  else if (feedback_mode == 1)  feedback_strategy = std::vector<uint32_t>{1, 2};
-  else if (feedback_mode == 2)  feedback_strategy = std::vector<uint32_t>{1, 3};
-  else if (feedback_mode == 3)  feedback_strategy = std::vector<uint32_t>{1, 4};
-  else if (feedback_mode == 4)  feedback_strategy = std::vector<uint32_t>{1, 5};
-  else if (feedback_mode == 5)  feedback_strategy = std::vector<uint32_t>{1, 6};
-  else if (feedback_mode == 6)  feedback_strategy = std::vector<uint32_t>{1, 2, 3};
-  else if (feedback_mode == 7)  feedback_strategy = std::vector<uint32_t>{1, 2, 4};
-  else if (feedback_mode == 8)  feedback_strategy = std::vector<uint32_t>{1, 2, 5};
-  else if (feedback_mode == 9)  feedback_strategy = std::vector<uint32_t>{1, 2, 6};
-  else if (feedback_mode == 10) feedback_strategy = std::vector<uint32_t>{1, 3, 4};
-  else if (feedback_mode == 11) feedback_strategy = std::vector<uint32_t>{1, 3, 5};
-  else if (feedback_mode == 12) feedback_strategy = std::vector<uint32_t>{1, 3, 6};
-  else if (feedback_mode == 13) feedback_strategy = std::vector<uint32_t>{1, 4, 5};
-  else if (feedback_mode == 14) feedback_strategy = std::vector<uint32_t>{1, 4, 6};
-  else if (feedback_mode == 15) feedback_strategy = std::vector<uint32_t>{1, 5, 6};
-  else if (feedback_mode == 16) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4};
-  else if (feedback_mode == 17) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 5};
-  else if (feedback_mode == 18) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 6};
-  else if (feedback_mode == 19) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 5};
-  else if (feedback_mode == 20) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 6};
-  else if (feedback_mode == 21) feedback_strategy = std::vector<uint32_t>{1, 2, 5, 6};
-  else if (feedback_mode == 22) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 5};
-  else if (feedback_mode == 23) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 6};
-  else if (feedback_mode == 24) feedback_strategy = std::vector<uint32_t>{1, 3, 5, 6};
-  else if (feedback_mode == 25) feedback_strategy = std::vector<uint32_t>{1, 4, 5, 6};
-  else if (feedback_mode == 26) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4, 5};
-  else if (feedback_mode == 27) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4, 6};
-  else if (feedback_mode == 28) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 5, 6};
-  else if (feedback_mode == 29) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 5, 6};
-  else if (feedback_mode == 30) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 5, 6};
+  feedback_strategy = feedback_strategy_mask(feedback_mode);
+
+  avalanche_histogram = get<int>(params, "avalanche_histogram", DEFAULT_AVALANCHE_HISTOGRAM);
+  if (avalanche_histogram) {
+    histogram = AvalancheHistogram(system_size, get<int>(params, "avalanche_bins_per_octave", DEFAULT_BINS_PER_OCTAVE));
+  }
 
   start_sampling = false;
 
-  surface = std::vector<int>(system_size, 0);
+  surface = BlockedSurface(std::vector<int>(system_size, 0));
+
+  lane_rng = LaneRandomGenerator(randi());
+  site_buffer = std::vector<uint32_t>(system_size - 2);
+  uniform_buffer = std::vector<double>(system_size - 2);
+
+  if (event_driven) {
+    // One event class per shape; a visited site deposits with probability pu or avalanches with probability pm
+    std::vector<double> rates(6);
+    for (uint32_t shape = 1; shape <= 6; shape++) {
+      rates[shape - 1] = in_feedback_strategy(feedback_strategy, shape) ? pu : pm;
+    }
+
+    engine = KineticEventEngine(system_size, system_size - 2, rates);
+    update_event_classes(1, system_size - 2);
+  }
 }
 
 std::string BlockSimulator::to_string() const {
@@ -88,33 +87,6 @@ std::string BlockSimulator::to_string() const {
   return s;
 }
 
-uint32_t BlockSimulator::get_shape(uint32_t s0, uint32_t s1, uint32_t s2) const {
-  int ds1 = s0 - s1;
-  int ds2 = s2 - s1;
-
-  if        ((ds1 == 0)  && (ds2 == 0))   {
-    return 1; // 0 0 0 (a)
-  } else if ((ds1 == -1) && (ds2 == -1))  {
-    return 2; // 0 1 0 (b)
-  } else if ((ds1 == 1)  && (ds2 == 1))  {
-    return 3; // 1 0 1 (c)
-  } else if ((ds1 == 0)  && (ds2 == 1)) {
-    return 4; // 0 0 1 (d)
-  } else if ((ds1 == 1)  && (ds2 == 0)) {
-    return 4; // 1 0 0
-  } else if ((ds1 == 0)  && (ds2 == -1)) {
-    return 5; // 1 1 0 (e)
-  } else if ((ds1 == -1) && (ds2 == 0)) { 
-    return 5; // 0 1 1
-  } else if ((ds1 == -1) && (ds2 == 1)) {
-    return 6; // 0 1 2 (f)
-  } else if ((ds1 == 1)  && (ds2 == -1)) {
-    return 6; // 2 1 0
-  } else {
-    throw std::invalid_argument("Something has gone wrong with the entropy substrate.");
-  }
-}
-
 double BlockSimulator::powerlaw(double d) const {
   double p = std::pow(d, -delta)/normalization;
   if (p < 0.0 || p > 1.0) {
@@ -125,55 +97,78 @@ double BlockSimulator::powerlaw(double d) const {
   return p;
 }
 
-void BlockSimulator::avalanche(uint32_t i) {
-  size_t size;
-  if (avalanche_type == BLOCKSIM_PEEL_AVALANCHE) {
-    if (precut && surface[i] > 0) {
-      surface[i]--;
+// Appends to avalanche_sites every site i + sign*d, 0 < d <= max_distance, independently with probability
+// powerlaw_table[d]. Since the table is decreasing in d, candidates are proposed by geometric skips with the
+// probability of the nearest remaining site and thinned to the exact probability, so that the cost is proportional
+// to the number of proposals rather than to max_distance.
+void BlockSimulator::sample_powerlaw_sites(uint32_t i, uint32_t max_distance, int sign) {
+  uint32_t d = 0;
+  while (d < max_distance) {
+    double q = powerlaw_table[d + 1];
+    if (q <= 0.0) {
+      return;
     }
 
-    uint32_t left = i;
-    while (surface[left-1] > surface[i]) {
-      left--;
+    double skip = (q >= 1.0) ? 0.0 : std::floor(std::log(1.0 - randf())/std::log1p(-q));
+    if (skip >= max_distance - d) {
+      return;
     }
 
-    uint32_t right = i;
-    while (surface[right+1] > surface[i]) {
-      right++;
+    d += 1 + static_cast<uint32_t>(skip);
+    if (randf()*q < powerlaw_table[d]) {
+      avalanche_sites.push_back(i + sign*static_cast<int>(d));
     }
+  }
+}
 
-    for (uint32_t j = left; j < i; j++) {
-      surface[j]--;
-    }
-    for (uint32_t j = i+1; j < right+1; j++) {
-      surface[j]--;
+std::pair<uint32_t, uint32_t> BlockSimulator::avalanche(uint32_t i) {
+  size_t size;
+  uint32_t left = i;
+  uint32_t right = i;
+  if (avalanche_type == BLOCKSIM_PEEL_AVALANCHE) {
+    if (precut && surface[i] > 0) {
+      surface.add(i, -1);
     }
 
+    // Extent of the sites above surface[i] on either side
+    left = surface.last_at_most(i, surface[i]) + 1;
+    right = surface.first_at_most(i + 1, surface[i]) - 1;
+
+    surface.add(left, i, -1);
+    surface.add(i + 1, right + 1, -1);
+
     size = right - left;
   } else if (avalanche_type == BLOCKSIM_POWERLAW_AVALANCHE) {
+    // Draw the sites which pass the distance test first; these do not depend on the surface, so checking
+    // can_desorb on them afterwards, in increasing order, is equivalent to the original left-to-right sweep.
+    avalanche_sites.clear();
+    avalanche_sites.push_back(i);
+    sample_powerlaw_sites(i, i - 1, -1);
+    sample_powerlaw_sites(i, system_size - 2 - i, 1);
+    std::sort(avalanche_sites.begin(), avalanche_sites.end());
+
     size = 0;
-    for (size_t j = 1; j < system_size-1; j++) {
+    for (uint32_t j : avalanche_sites) {
       if (can_desorb(j)) {
-        double p;
-        if (i == j) {
-          p = 1.0;
-        } else {
-          double distance = std::abs(int(i) - int(j));
-          p = powerlaw(distance);
-        }
+        surface.add(j, -1);
+        size++;
 
-        if (randf() < p) {
-          surface[j]--;
-          size++;
+        if (event_driven) {
+          update_event_classes(j, j);
         }
       }
     }
   }
 
-
   if (size > 0 && start_sampling) {
-    sampler.record_size(size);
+    if (avalanche_histogram) {
+      histogram.record(size);
+    } else {
+      sampler.record_size(size);
+    }
   }
+
+  return std::make_pair(left, right);
 }
 
 bool BlockSimulator::can_desorb(uint32_t i) const {
@@ -185,7 +180,7 @@ bool BlockSimulator::can_desorb(uint32_t i) const {
     return false;
   }
 
-  uint32_t shape = get_shape(surface[i-1], surface[i], surface[i+1]);
+  uint32_t shape = surface_shape(surface[i-1], surface[i], surface[i+1]);
 
 
   //             (a)           (b)           (e)
@@ -197,53 +192,95 @@ bool BlockSimulator::can_deposit(uint32_t i) const {
     return false;
   }
 
-  uint32_t shape = get_shape(surface[i-1], surface[i], surface[i+1]);
+  uint32_t shape = surface_shape(surface[i-1], surface[i], surface[i+1]);
 
   //             (a)           (c)           (d)
   return shape == 1 || shape == 3 || shape == 4;
 }
 
-void BlockSimulator::deposit(uint32_t i) {
+std::pair<uint32_t, uint32_t> BlockSimulator::deposit(uint32_t i) {
   if (depositing_type == 0) {
     if (can_deposit(i)) {
-      surface[i]++;
+      surface.add(i, 1);
     }
+
+    return std::make_pair(i, i);
   } else if (depositing_type == 1) {
     bool continue_depositing = true;
 
     while (continue_depositing) {
       continue_depositing = false;
       if (can_deposit(i-1)) {
-        surface[i-1]++;
+        surface.add(i-1, 1);
         continue_depositing = true;
       }
 
       if (can_deposit(i)) {
-        surface[i]++;
+        surface.add(i, 1);
         continue_depositing = true;
       }
 
       if (can_deposit(i+1)) {
-        surface[i+1]++;
+        surface.add(i+1, 1);
         continue_depositing = true;
       }
     }
+
+    return std::make_pair(i-1, i+1);
+  }
+
+  return std::make_pair(i, i);
+}
+
+// Reclassifies the sites whose shape may have changed after modifying surface[left..right]
+void BlockSimulator::update_event_classes(uint32_t left, uint32_t right) {
+  uint32_t i1 = std::max(left, 2u) - 1;
+  uint32_t i2 = std::min(right + 1, system_size - 2);
+  for (uint32_t i = i1; i <= i2; i++) {
+    engine.set_class(i, surface_shape(surface[i-1], surface[i], surface[i+1]) - 1);
   }
 }
 
+void BlockSimulator::event_driven_timesteps(uint32_t num_steps) {
+  uint64_t num_visits = static_cast<uint64_t>(num_steps)*(system_size - 2);
+  engine.advance(num_visits, [this](uint32_t q) {
+    uint32_t shape = engine.get_class(q) + 1;
+
+    std::pair<uint32_t, uint32_t> modified;
+    if (in_feedback_strategy(feedback_strategy, shape)) {
+      modified = deposit(q);
+    } else {
+      modified = avalanche(q);
+    }
+
+    update_event_classes(modified.first, modified.second);
+  });
+}
+
 void BlockSimulator::timesteps(uint32_t num_steps) {
+  if (event_driven) {
+    event_driven_timesteps(num_steps);
+    return;
+  }
+
   for (uint32_t k = 0; k < num_steps; k++) {
+    // Draw the sites and acceptance probabilities for the whole sweep at once
+    if (random_sites) {
+      lane_rng.fill_indices(site_buffer, system_size - 2);
+    }
+    lane_rng.fill_uniform(uniform_buffer);
+
     for (uint32_t i = 1; i < system_size - 1; i++) {
-      uint32_t q = random_sites ? rand() % (system_size - 2) + 1 : i;
+      uint32_t q = random_sites ? site_buffer[i - 1] + 1 : i;
 
-      uint32_t shape = get_shape(surface[q-1], surface[q], surface[q+1]);
+      uint32_t shape = surface_shape(surface[q-1], surface[q], surface[q+1]);
 
-      if (std::count(feedback_strategy.begin(), feedback_strategy.end(), shape)) {
-        if (randf() < pu) {
+      if (in_feedback_strategy(feedback_strategy, shape)) {
+        if (uniform_buffer[i - 1] < pu) {
           deposit(q);
         }
       } else {
-        if (randf() < pm) {
+        if (uniform_buffer[i - 1] < pm) {
           avalanche(q);
         }
       }
@@ -253,7 +290,10 @@ void BlockSimulator::timesteps(uint32_t num_steps) {
 
 SampleMap BlockSimulator::take_samples() {
   SampleMap samples;
-  sampler.add_samples(samples, surface);
+  sampler.add_samples(samples, surface.to_vector());
+  if (avalanche_histogram) {
+    histogram.add_samples(samples);
+  }
   return samples;
 }
 
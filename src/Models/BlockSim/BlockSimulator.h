@@ -3,36 +3,56 @@
 #include <Simulator.hpp>
 #include <Samplers.h>
 
+#include <AvalancheHistogram.hpp>
+
+#include "BlockedSurface.hpp"
+#include "KineticEventEngine.hpp"
+#include "LaneRandomGenerator.hpp"
+#include "SurfaceShapes.hpp"
+
 class BlockSimulator : public Simulator {
   private:
     uint32_t system_size;
     double pu;
     double pm;
-    std::vector<int> surface;
+    BlockedSurface surface;
 
     bool random_sites;
+    bool event_driven;
+    KineticEventEngine engine;
+
+    LaneRandomGenerator lane_rng;
+    std::vector<uint32_t> site_buffer;
+    std::vector<double> uniform_buffer;
 
     bool precut;
 
     bool start_sampling;
 
     uint32_t feedback_mode;
-    std::vector<uint32_t> feedback_strategy;
+    uint32_t feedback_strategy;
 
     uint32_t depositing_type;
     uint32_t avalanche_type;
     double delta;
     double normalization;
+    std::vector<double> powerlaw_table;
+    std::vector<uint32_t> avalanche_sites;
 
     InterfaceSampler sampler;
 
-    uint32_t get_shape(uint32_t s0, uint32_t s1, uint32_t s2) const;
+    bool avalanche_histogram;
+    AvalancheHistogram histogram;
 
     double powerlaw(double d) const;
+    void sample_powerlaw_sites(uint32_t i, uint32_t max_distance, int sign);
     bool can_desorb(uint32_t i) const;
-    void avalanche(uint32_t i);
+    std::pair<uint32_t, uint32_t> avalanche(uint32_t i);
     bool can_deposit(uint32_t i) const;
-    void deposit(uint32_t i);
+    std::pair<uint32_t, uint32_t> deposit(uint32_t i);
+
+    void update_event_classes(uint32_t left, uint32_t right);
+    void event_driven_timesteps(uint32_t num_steps);
 
   public:
     BlockSimulator(dataframe::ExperimentParams &params, uint32_t);
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+// Integer surface split into blocks of ~sqrt(L) sites, each carrying a lazy height offset and the minimum of its
+// stored heights. Reading a height stays O(1), which matters since every visited site reads its neighbours, while
+// range additions and searches for the nearest site not above a given height skip over whole blocks, so that an
+// avalanche spanning s sites costs O(sqrt(L)) rather than O(s).
+class BlockedSurface {
+  public:
+    BlockedSurface()=default;
+
+    BlockedSurface(const std::vector<int>& surface) : values(surface) {
+      size_t n = values.size();
+      block_size = std::max<size_t>(16, std::sqrt(n));
+      num_blocks = (n + block_size - 1)/block_size;
+      offsets = std::vector<int>(num_blocks, 0);
+      minima = std::vector<int>(num_blocks, 0);
+      dirty = std::vector<bool>(num_blocks, true);
+    }
+
+    inline int operator[](size_t i) const {
+      return values[i] + offsets[i / block_size];
+    }
+
+    size_t size() const {
+      return values.size();
+    }
+
+    inline void add(size_t i, int v) {
+      size_t b = i / block_size;
+      if (v < 0) {
+        values[i] += v;
+        minima[b] = std::min(minima[b], values[i]);
+      } else {
+        if (values[i] == minima[b]) {
+          dirty[b] = true;
+        }
+        values[i] += v;
+      }
+    }
+
+    // Adds v to every site in [left, right)
+    void add(size_t left, size_t right, int v) {
+      size_t i = left;
+      while (i < right) {
+        size_t b = i / block_size;
+        size_t block_end = std::min((b + 1)*block_size, values.size());
+        if (i == b*block_size && block_end <= right) {
+          offsets[b] += v;
+          i = block_end;
+        } else {
+          size_t stop = std::min(block_end, right);
+          for (; i < stop; i++) {
+            add(i, v);
+          }
+        }
+      }
+    }
+
+    // Largest j in [0, stop) with height at most h, or -1 if there is none
+    int64_t last_at_most(size_t stop, int h) {
+      size_t i = stop;
+      while (i > 0) {
+        size_t b = (i - 1) / block_size;
+        size_t block_start = b*block_size;
+        if (i == std::min((b + 1)*block_size, values.size()) && block_min(b) > h) {
+          i = block_start;
+          continue;
+        }
+
+        for (; i > block_start; i--) {
+          if ((*this)[i - 1] <= h) {
+            return i - 1;
+          }
+        }
+      }
+
+      return -1;
+    }
+
+    // Smallest j in [start, L) with height at most h, or L if there is none
+    size_t first_at_most(size_t start, int h) {
+      size_t i = start;
+      while (i < values.size()) {
+        size_t b = i / block_size;
+        size_t block_end = std::min((b + 1)*block_size, values.size());
+        if (i == b*block_size && block_min(b) > h) {
+          i = block_end;
+          continue;
+        }
+
+        for (; i < block_end; i++) {
+          if ((*this)[i] <= h) {
+            return i;
+          }
+        }
+      }
+
+      return values.size();
+    }
+
+    std::vector<int> to_vector() const {
+      std::vector<int> surface(values.size());
+      for (size_t i = 0; i < values.size(); i++) {
+        surface[i] = (*this)[i];
+      }
+
+      return surface;
+    }
+
+  private:
+    size_t block_size;
+    size_t num_blocks;
+    std::vector<int> values;
+    std::vector<int> offsets;
+    std::vector<int> minima;
+    std::vector<bool> dirty;
+
+    int block_min(size_t b) {
+      if (dirty[b]) {
+        size_t block_end = std::min((b + 1)*block_size, values.size());
+        minima[b] = *std::min_element(values.begin() + b*block_size, values.begin() + block_end);
+        dirty[b] = false;
+      }
+
+      return minima[b] + offsets[b];
+    }
+};
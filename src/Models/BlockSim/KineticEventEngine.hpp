@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Simulator.hpp>
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+// Rejection-free (BKL) kinetic Monte Carlo for surface models in which every timestep visits uniformly random
+// candidate sites, and a visited site in class c accepts its move with probability rates[c]. Sites are kept
+// in per-class lists with O(1) add/remove. Instead of drawing every visit, the number of visits until the
+// next accepted move is drawn from a geometric distribution, and the accepted site is drawn in proportion to
+// the rate of its class; this reproduces the sequence of accepted moves of the rejection-based dynamics exactly.
+class KineticEventEngine {
+  public:
+    static constexpr uint32_t NO_CLASS = std::numeric_limits<uint32_t>::max();
+
+    KineticEventEngine()=default;
+
+    KineticEventEngine(uint32_t num_sites, uint32_t num_candidates, const std::vector<double>& rates)
+      : num_candidates(num_candidates), rates(rates), members(rates.size()), site_class(num_sites, NO_CLASS), position(num_sites, 0) {}
+
+    void set_class(uint32_t i, uint32_t c) {
+      uint32_t c0 = site_class[i];
+      if (c0 == c) {
+        return;
+      }
+
+      if (c0 != NO_CLASS) {
+        std::vector<uint32_t>& list = members[c0];
+        uint32_t j = list.back();
+        list[position[i]] = j;
+        position[j] = position[i];
+        list.pop_back();
+      }
+
+      if (c != NO_CLASS) {
+        position[i] = members[c].size();
+        members[c].push_back(i);
+      }
+
+      site_class[i] = c;
+    }
+
+    uint32_t get_class(uint32_t i) const {
+      return site_class[i];
+    }
+
+    double total_rate() const {
+      double rate = 0.0;
+      for (size_t c = 0; c < rates.size(); c++) {
+        rate += rates[c]*members[c].size();
+      }
+
+      return rate;
+    }
+
+    // Advances the dynamics by num_visits visits, calling event(i) for every accepted site i. The event is
+    // responsible for updating the classes of any sites it modifies.
+    template <typename F>
+    void advance(uint64_t num_visits, F&& event) {
+      while (true) {
+        uint64_t t = waiting_time();
+        if (t > num_visits) {
+          return;
+        }
+
+        num_visits -= t;
+        event(next_site());
+      }
+    }
+
+  private:
+    uint32_t num_candidates;
+    std::vector<double> rates;
+    std::vector<std::vector<uint32_t>> members;
+    std::vector<uint32_t> site_class;
+    std::vector<uint32_t> position;
+
+    // Number of visits up to and including the next accepted one
+    uint64_t waiting_time() const {
+      double p = total_rate()/num_candidates;
+      if (p <= 0.0) {
+        return std::numeric_limits<uint64_t>::max();
+      } else if (p >= 1.0) {
+        return 1;
+      }
+
+      double t = std::floor(std::log(1.0 - randf())/std::log1p(-p));
+      if (t >= static_cast<double>(std::numeric_limits<uint64_t>::max() - 1)) {
+        return std::numeric_limits<uint64_t>::max();
+      }
+
+      return 1 + static_cast<uint64_t>(t);
+    }
+
+    uint32_t next_site() const {
+      double r = randf()*total_rate();
+      size_t c = 0;
+      for (; c < rates.size(); c++) {
+        double w = rates[c]*members[c].size();
+        if (r < w) {
+          break;
+        }
+        r -= w;
+      }
+
+      // Guard against rounding in the cumulative sum
+      while (c == rates.size() || rates[c] == 0.0 || members[c].empty()) {
+        c = (c == 0) ? rates.size() - 1 : c - 1;
+      }
+
+      return members[c][randi() % members[c].size()];
+    }
+};
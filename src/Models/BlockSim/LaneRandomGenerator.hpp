@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Random number generator which advances LANES independent xoshiro128+ streams in lockstep, stored as
+// structure-of-arrays so that the update vectorizes. Used to draw the random sites and acceptance
+// probabilities of a whole sweep at once, rather than one call to rand()/randf() per visit.
+class LaneRandomGenerator {
+  public:
+    static constexpr size_t LANES = 8;
+
+    LaneRandomGenerator(uint64_t seed=0) {
+      // Seed every lane with splitmix64
+      for (size_t l = 0; l < LANES; l++) {
+        for (size_t k = 0; k < 4; k++) {
+          seed += 0x9e3779b97f4a7c15ull;
+          uint64_t z = seed;
+          z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+          z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+          z = z ^ (z >> 31);
+          state[k][l] = static_cast<uint32_t>(z) | 1u;
+        }
+      }
+    }
+
+    // Uniform integers on [0, n)
+    void fill_indices(std::vector<uint32_t>& out, uint32_t n) {
+      fill(out.size(), [&out, n](size_t i, uint32_t x) {
+        out[i] = static_cast<uint32_t>((static_cast<uint64_t>(x)*n) >> 32);
+      });
+    }
+
+    // Uniform doubles on [0, 1) with 53 random bits, built from two outputs of each lane: all 32 bits of the first and
+    // the upper 21 bits of the second, whose lowest bits are the weakest of xoshiro128+. A coarser grid would round
+    // small acceptance probabilities up to its spacing.
+    void fill_uniform(std::vector<double>& out) {
+      uint32_t hi[LANES];
+      uint32_t lo[LANES];
+      for (size_t i = 0; i < out.size(); i += LANES) {
+        next(hi);
+        next(lo);
+        for (size_t l = 0; l < LANES && i + l < out.size(); l++) {
+          out[i + l] = ((static_cast<uint64_t>(hi[l]) << 21) ^ (lo[l] >> 11))*1.1102230246251565e-16;
+        }
+      }
+    }
+
+  private:
+    uint32_t state[4][LANES];
+
+    static inline uint32_t rotl(uint32_t x, int k) {
+      return (x << k) | (x >> (32 - k));
+    }
+
+    inline void next(uint32_t* result) {
+      for (size_t l = 0; l < LANES; l++) {
+        result[l] = state[0][l] + state[3][l];
+        uint32_t t = state[1][l] << 9;
+        state[2][l] ^= state[0][l];
+        state[3][l] ^= state[1][l];
+        state[1][l] ^= state[2][l];
+        state[0][l] ^= state[3][l];
+        state[2][l] ^= t;
+        state[3][l] = rotl(state[3][l], 11);
+      }
+    }
+
+    template <typename F>
+    void fill(size_t n, F&& f) {
+      uint32_t block[LANES];
+      for (size_t i = 0; i < n; i += LANES) {
+        next(block);
+        for (size_t l = 0; l < LANES && i + l < n; l++) {
+          f(i + l, block[l]);
+        }
+      }
+    }
+};
@@ -3,6 +3,14 @@
 #define SUBSTRATE 0
 #define PYRAMID 1
 
+#define DEFAULT_EVENT_DRIVEN false
+#define DEFAULT_AVALANCHE_HISTOGRAM false
+#define DEFAULT_BINS_PER_OCTAVE 4
+
+#define RPM_MAXIMUM 0
+#define RPM_MINIMUM 1
+#define RPM_SLOPE 2
+
 using namespace dataframe;
 using namespace dataframe::utils;
 
@@ -17,6 +25,7 @@ RPMSimulator::RPMSimulator(ExperimentParams &params, uint32_t) : Simulator(param
 
   pbc = get<int>(params, "pbc", false);
   initial_state = get<int>(params, "initial_state", SUBSTRATE);
+  event_driven = get<int>(params, "event_driven", DEFAULT_EVENT_DRIVEN);
 
   num_sites = 2*system_size;
   if (!pbc) {
@@ -25,25 +34,49 @@ RPMSimulator::RPMSimulator(ExperimentParams &params, uint32_t) : Simulator(param
 
   params.emplace("u", pu/pm);
 
+  avalanche_histogram = get<int>(params, "avalanche_histogram", DEFAULT_AVALANCHE_HISTOGRAM);
+  if (avalanche_histogram) {
+    histogram = AvalancheHistogram(num_sites, get<int>(params, "avalanche_bins_per_octave", DEFAULT_BINS_PER_OCTAVE));
+  }
+
   start_sampling = false;
 
-  surface = std::vector<int>(num_sites, 0);
+  std::vector<int> initial_surface(num_sites, 0);
   if (initial_state == SUBSTRATE) {
     for (uint32_t i = 0; i < num_sites; i++) {
       if (i % 2 == 1) {
-        surface[i]++;
+        initial_surface[i]++;
       }
     }
   } else if (initial_state == PYRAMID) {
     for (uint32_t i = 0; i < system_size; i++) {
-      surface[i] = i;
-      surface[num_sites - i - 1] = i + static_cast<int>(pbc);
+      initial_surface[i] = i;
+      initial_surface[num_sites - i - 1] = i + static_cast<int>(pbc);
     }
 
     if (!pbc) {
-      surface[system_size] = system_size;
+      initial_surface[system_size] = system_size;
     }
   }
+
+  surface = BlockedSurface(initial_surface);
+
+  lane_rng = LaneRandomGenerator(randi());
+  site_buffer = std::vector<uint32_t>(num_sites);
+  uniform_buffer = std::vector<double>(num_sites);
+
+  if (event_driven) {
+    // A visited local maximum does nothing, a local minimum is raised with probability pu, and a sloped
+    // section is peeled with probability pm
+    std::vector<double> rates(3);
+    rates[RPM_MAXIMUM] = 0.0;
+    rates[RPM_MINIMUM] = pu;
+    rates[RPM_SLOPE] = pm;
+
+    uint32_t num_candidates = pbc ? num_sites : num_sites - 2;
+    engine = KineticEventEngine(num_sites, num_candidates, rates);
+    update_event_classes(0, num_sites - 1);
+  }
 }
 
 std::string RPMSimulator::to_string() const {
@@ -61,57 +94,114 @@ int RPMSimulator::slope(uint32_t i) const {
   return (surface[mod(i+1, num_sites)] - surface[mod(i-1, num_sites)])/2;
 }
 
-void RPMSimulator::peel(uint32_t i, bool right) {
-  if (randf() > pm) {
-    return;
-  }
-
-  int j = i;
+std::pair<int, int> RPMSimulator::peel(uint32_t i, bool right) {
+  // Nearest site on the given side (wrapping around) which is not above surface[i]
+  int h = surface[i];
+  int j;
   if (right) {
-    while (surface[mod(j+1, num_sites)] > surface[i]) {
-      j++;
-    } 
-    j++;
+    j = surface.first_at_most(i + 1, h);
+    if (j == static_cast<int>(num_sites)) {
+      j = surface.first_at_most(0, h) + num_sites;
+    }
   } else {
-    while (surface[mod(j-1, num_sites)] > surface[i]) {
-      j--;
-    } 
-    j--;
+    j = surface.last_at_most(i, h);
+    if (j == -1) {
+      j = surface.last_at_most(num_sites, h) - num_sites;
+    }
   }
 
   int li = std::min(static_cast<int>(i), j);
   int ri = std::max(static_cast<int>(i), j);
 
-  for (int k = li+1; k < ri; k++) {
-    surface[mod(k, num_sites)] -= 2;
+  // Lower (li, ri), split where it wraps around
+  if (li + 1 < 0) {
+    surface.add(li + 1 + num_sites, num_sites, -2);
+    surface.add(0, ri, -2);
+  } else if (ri > static_cast<int>(num_sites)) {
+    surface.add(li + 1, num_sites, -2);
+    surface.add(0, ri - num_sites, -2);
+  } else {
+    surface.add(li + 1, ri, -2);
   }
 
   uint32_t size = (ri - li)/2;
   if (size > 0 && start_sampling) {
-    sampler.record_size(size);
+    if (avalanche_histogram) {
+      histogram.record(size);
+    } else {
+      sampler.record_size(size);
+    }
   }
+
+  return std::make_pair(li, ri);
 }
 
 void RPMSimulator::raise(uint32_t i) {
-  if (randf() < pu) {
-    surface[i] += 2;
+  surface.add(i, 2);
+}
+
+uint32_t RPMSimulator::event_class(uint32_t i) const {
+  int s = slope(i);
+  if (!s && surface[i] > surface[mod(i - 1, num_sites)]) {
+    return RPM_MAXIMUM;
+  } else if (!s && surface[i] < surface[mod(i - 1, num_sites)]) {
+    return RPM_MINIMUM;
+  } else {
+    return RPM_SLOPE;
+  }
+}
+
+// Reclassifies the candidate sites in [left, right] (taken modulo num_sites)
+void RPMSimulator::update_event_classes(int left, int right) {
+  for (int k = left; k <= right; k++) {
+    uint32_t i = mod(k, num_sites);
+    if (pbc || (i > 0 && i < num_sites - 1)) {
+      engine.set_class(i, event_class(i));
+    }
   }
 }
 
+void RPMSimulator::event_driven_timesteps(uint32_t num_steps) {
+  uint32_t num_candidates = pbc ? num_sites : num_sites - 2;
+  uint64_t num_visits = static_cast<uint64_t>(num_steps)*num_candidates;
+  engine.advance(num_visits, [this](uint32_t q) {
+    if (engine.get_class(q) == RPM_MINIMUM) {
+      raise(q);
+      update_event_classes(int(q) - 1, int(q) + 1);
+    } else {
+      auto [li, ri] = peel(q, slope(q) > 0);
+      update_event_classes(li, ri);
+    }
+  });
+}
+
 void RPMSimulator::timesteps(uint32_t num_steps) {
+  if (event_driven) {
+    event_driven_timesteps(num_steps);
+    return;
+  }
+
   for (uint32_t k = 0; k < num_steps; k++) {
+    // Draw the sites and acceptance probabilities for the whole sweep at once
+    lane_rng.fill_indices(site_buffer, pbc ? num_sites : num_sites - 2);
+    lane_rng.fill_uniform(uniform_buffer);
+
     for (uint32_t i = 0; i < num_sites; i++) {
-      uint32_t q = pbc ? rand() % num_sites : rand() % (num_sites - 2) + 1;
+      uint32_t q = pbc ? site_buffer[i] : site_buffer[i] + 1;
 
       int s = slope(q);
       if (!s && surface[q] > surface[mod(q - 1, num_sites)]) {
         // Tile hits a local maximum; do nothing
       } else if (!s && surface[q] < surface[mod(q - 1, num_sites)]) {
         // Tile hits a local minimum; raise
-        raise(q);
+        if (uniform_buffer[i] < pu) {
+          raise(q);
+        }
       } else {
         // Hits a sloped section; peel
-        peel(q, s > 0);
+        if (uniform_buffer[i] < pm) {
+          peel(q, s > 0);
+        }
       }
     }
   }
@@ -119,10 +209,14 @@ void RPMSimulator::timesteps(uint32_t num_steps) {
 
 SampleMap RPMSimulator::take_samples() {
   int N = pbc ? num_sites : num_sites - 1;
-  std::vector<int> sampled_surface(surface.begin(), surface.begin() + N);
+  std::vector<int> sampled_surface = surface.to_vector();
+  sampled_surface.resize(N);
 
   SampleMap samples;
   sampler.add_samples(samples, sampled_surface);
+  if (avalanche_histogram) {
+    histogram.add_samples(samples);
+  }
   return samples;
 }
 
@@ -3,6 +3,12 @@
 #include <Simulator.hpp>
 #include <Samplers.h>
 
+#include <AvalancheHistogram.hpp>
+
+#include "BlockedSurface.hpp"
+#include "KineticEventEngine.hpp"
+#include "LaneRandomGenerator.hpp"
+
 class RPMSimulator : public Simulator {
   private:
     uint32_t system_size;
@@ -12,16 +18,30 @@ class RPMSimulator : public Simulator {
     bool pbc;
     uint32_t initial_state;
 
-    std::vector<int> surface;
+    BlockedSurface surface;
 
     bool start_sampling;
 
+    bool event_driven;
+    KineticEventEngine engine;
+
+    LaneRandomGenerator lane_rng;
+    std::vector<uint32_t> site_buffer;
+    std::vector<double> uniform_buffer;
+
     InterfaceSampler sampler;
 
-    void peel(uint32_t i, bool right);
+    bool avalanche_histogram;
+    AvalancheHistogram histogram;
+
+    std::pair<int, int> peel(uint32_t i, bool right);
     void raise(uint32_t i);
     int slope(uint32_t i) const;
 
+    uint32_t event_class(uint32_t i) const;
+    void update_event_classes(int left, int right);
+    void event_driven_timesteps(uint32_t num_steps);
+
   public:
     RPMSimulator(dataframe::ExperimentParams &params, uint32_t);
 
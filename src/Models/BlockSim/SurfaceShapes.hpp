@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+// ------------------ TETRONIMOS -------------------
+// |  (1)  |  (2)  |  (3)  |  (4)  |  (5)  |  (6)  |
+// |       |       |       |       |       | o     |
+// |       |   o   | o   o | o     | o o   | o o   |
+// | o o o | o o o | o o o | o o o | o o o | o o o |
+
+// Shape of a site indexed by 3*(ds1 + 1) + (ds2 + 1), where ds1 = s0 - s1 and ds2 = s2 - s1
+static constexpr std::array<uint32_t, 9> SURFACE_SHAPE_TABLE = {
+//  ds2 = -1  0  1
+          2,  5, 6, // ds1 = -1
+          5,  1, 4, // ds1 =  0
+          6,  4, 3  // ds1 =  1
+};
+
+static inline uint32_t surface_shape(int s0, int s1, int s2) {
+  uint32_t i1 = s0 - s1 + 1;
+  uint32_t i2 = s2 - s1 + 1;
+  if (i1 > 2 || i2 > 2) {
+    throw std::invalid_argument("Something has gone wrong with the entropy substrate.");
+  }
+
+  return SURFACE_SHAPE_TABLE[3*i1 + i2];
+}
+
+// Feedback strategies are sets of shapes, stored as bitmasks with bit s set if shape s is included. Every
+// strategy contains shape 1; feedback_mode enumerates the subsets of shapes {2, ..., 6} by size and then
+// lexicographically, i.e. {1}, {1, 2}, ..., {1, 6}, {1, 2, 3}, ..., {1, 2, 3, 4, 5, 6}.
+static constexpr std::array<uint32_t, 32> make_feedback_strategies() {
+  std::array<uint32_t, 32> strategies{};
+  size_t n = 0;
+  for (int k = 0; k <= 5; k++) {
+    int c[5] = {0, 1, 2, 3, 4};
+    while (true) {
+      uint32_t mask = 1u << 1;
+      for (int i = 0; i < k; i++) {
+        mask |= 1u << (c[i] + 2);
+      }
+      strategies[n++] = mask;
+
+      int i = k - 1;
+      while (i >= 0 && c[i] == 5 - k + i) {
+        i--;
+      }
+
+      if (i < 0) {
+        break;
+      }
+
+      c[i]++;
+      for (int j = i + 1; j < k; j++) {
+        c[j] = c[j - 1] + 1;
+      }
+    }
+  }
+
+  return strategies;
+}
+
+static constexpr std::array<uint32_t, 32> FEEDBACK_STRATEGIES = make_feedback_strategies();
+
+static_assert(FEEDBACK_STRATEGIES[0] == 0b0000010);  // {1}
+static_assert(FEEDBACK_STRATEGIES[22] == 0b0111010); // {1, 3, 4, 5}
+static_assert(FEEDBACK_STRATEGIES[31] == 0b1111110); // {1, 2, 3, 4, 5, 6}
+
+static inline uint32_t feedback_strategy_mask(uint32_t feedback_mode) {
+  if (feedback_mode >= FEEDBACK_STRATEGIES.size()) {
+    throw std::invalid_argument("Invalid feedback mode.");
+  }
+
+  return FEEDBACK_STRATEGIES[feedback_mode];
+}
+
+static inline bool in_feedback_strategy(uint32_t strategy, uint32_t shape) {
+  return (strategy >> shape) & 1u;
+}
@@ -1,4 +1,5 @@
 #include "BulkMeasurementSimulator.h"
+#include "PrefixEntropy.hpp"
 
 #define DEFAULT_ENV_DIM 1
 
@@ -13,10 +14,33 @@ BulkMeasurementSimulator::BulkMeasurementSimulator(ExperimentParams &params, uin
     throw std::invalid_argument(error_message);
   }
 
+  if (L < 2) {
+    throw std::invalid_argument("BulkMeasurementSimulator requires a lattice of at least 2x2 qubits.");
+  }
+
 	mzr_prob = get<double>(params, "mzr_prob");
 
   circuit_depth = get<int>(params, "circuit_depth");
 
+  // Nearest neighbours of every site, stored contiguously
+  neighbor_offsets = std::vector<uint32_t>(system_size + 1, 0);
+  for (uint32_t q = 0; q < system_size; q++) {
+    auto [s1, s2] = two_dim_coordinates(q, L);
+    if (s1 > 0) {
+      neighbor_targets.push_back(site_index(s1 - 1, s2, L));
+    }
+    if (s2 > 0) {
+      neighbor_targets.push_back(site_index(s1, s2 - 1, L));
+    }
+    if (s1 < L - 1) {
+      neighbor_targets.push_back(site_index(s1 + 1, s2, L));
+    }
+    if (s2 < L - 1) {
+      neighbor_targets.push_back(site_index(s1, s2 + 1, L));
+    }
+    neighbor_offsets[q + 1] = neighbor_targets.size();
+  }
+
 	state = std::make_shared<QuantumCHPState>(system_size);
 }
 
@@ -29,36 +53,15 @@ uint32_t BulkMeasurementSimulator::site_index(uint32_t s1, uint32_t s2, uint32_t
 }
 
 void BulkMeasurementSimulator::timesteps(uint32_t num_steps) {
+  // Random nearest-neighbour gates; the partner is drawn uniformly from the lattice neighbours of the first site
+  std::vector<uint32_t> qubits(2);
   for (uint32_t i = 0; i < circuit_depth; i++) {
     uint32_t q1 = rand() % system_size;
-    auto [s1, s2] = two_dim_coordinates(q1, L);
-
-    uint32_t direction = rand() % 4;
-
-    while ((s1 == 0 && direction == 0) 
-        || (s1 == L-1 && direction == 2)
-        || (s2 == 0 && direction == 1) 
-        || (s2 == L-1 && direction == 3)) {
-      direction = rand() % 4;
-    }
+    uint32_t num_neighbors = neighbor_offsets[q1 + 1] - neighbor_offsets[q1];
+    uint32_t q2 = neighbor_targets[neighbor_offsets[q1] + rand() % num_neighbors];
 
-    uint32_t s1t, s2t;
-    if (direction == 0) {
-      s1t = s1 - 1;
-      s2t = s2;
-    } else if (direction == 1) {
-      s1t = s1;
-      s2t = s2 - 1;
-    } else if (direction == 2) {
-      s1t = s1 + 1;
-      s2t = s2;
-    } else {
-      s1t = s1;
-      s2t = s2 + 1;
-    }
-
-    uint32_t q2 = site_index(s1t, s2t, L);
-    std::vector<uint32_t> qubits{q1, q2};
+    qubits[0] = q1;
+    qubits[1] = q2;
     state->random_clifford(qubits);
   }
 
@@ -77,13 +80,10 @@ void BulkMeasurementSimulator::timesteps(uint32_t num_steps) {
 SampleMap BulkMeasurementSimulator::take_samples() {
 	SampleMap samples;
 
-  std::vector<double> entropy(L);
-  for (uint32_t q = 0; q < L; q++) {
-    std::vector<uint32_t> qubits(q);
-    std::iota(qubits.begin(), qubits.end(), 0);
+  // Entropies of the prefixes [0, q) for q < L from a single elimination sweep
+  std::vector<int> prefix = prefix_entropies(*state, L - 1);
 
-    entropy[q] = state->entanglement(qubits, 2);
-  }
+  std::vector<double> entropy(prefix.begin(), prefix.end());
 
   emplace(samples, "surface", entropy);
 
@@ -15,6 +15,10 @@ class BulkMeasurementSimulator : public Simulator {
 
 		std::shared_ptr<QuantumCHPState> state;
 
+		// Lattice neighbours of site q are neighbor_targets[neighbor_offsets[q]:neighbor_offsets[q+1]]
+		std::vector<uint32_t> neighbor_offsets;
+		std::vector<uint32_t> neighbor_targets;
+
 		EntropySampler sampler;
 
 		std::pair<uint32_t, uint32_t> two_dim_coordinates(uint32_t, uint32_t);
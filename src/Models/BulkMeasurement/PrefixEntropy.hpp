@@ -0,0 +1,252 @@
+#pragma once
+
+#include <CliffordState.h>
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+// Stabilizer generators packed one row per generator, with the Pauli on qubit j in columns 2j (x) and 2j + 1 (z). The
+// rows may generate the group of a mixed state, in which case there are fewer rows than qubits.
+class StabilizerRows {
+  public:
+    uint32_t num_qubits;
+    uint32_t num_rows;
+    size_t num_words;
+    std::vector<uint64_t> words;
+
+    StabilizerRows(uint32_t num_qubits, uint32_t num_rows)
+      : num_qubits(num_qubits), num_rows(num_rows), num_words((2*static_cast<size_t>(num_qubits) + 63)/64),
+        words(num_rows*num_words, 0) {}
+
+    // Stabilizer rows of the tableau of a CHP state. The tableau layout belongs to the external Clifford library, so it
+    // is checked rather than assumed: there must be num_qubits stabilizer rows, optionally preceded by as many
+    // destabilizers and followed by one scratch row, each acting on num_qubits qubits. As a guard against reading the
+    // destabilizers instead, the entropy of the left half is compared with the state's own.
+    explicit StabilizerRows(QuantumCHPState& state) : StabilizerRows(state.num_qubits, state.num_qubits) {
+      const auto& rows = state.tableau.rows;
+      if (rows.size() != num_qubits && rows.size() != 2*num_qubits && rows.size() != 2*num_qubits + 1) {
+        throw std::runtime_error("Unexpected number of tableau rows when reading stabilizers.");
+      }
+      for (auto const& row : rows) {
+        if (row.num_qubits != num_qubits) {
+          throw std::runtime_error("Unexpected tableau row width when reading stabilizers.");
+        }
+      }
+
+      uint32_t first = (rows.size() == num_qubits) ? 0 : num_qubits;
+      for (uint32_t i = 0; i < num_rows; i++) {
+        for (uint32_t j = 0; j < num_qubits; j++) {
+          set(i, j, rows[first + i].x(j), rows[first + i].z(j));
+        }
+      }
+
+      std::vector<uint32_t> half(num_qubits/2);
+      std::iota(half.begin(), half.end(), 0);
+      if (std::abs(state.entanglement(half, 2) - entropy(half)) > 1e-8) {
+        throw std::runtime_error("Stabilizer rows read from the tableau do not reproduce the state's entropy.");
+      }
+    }
+
+    bool x(uint32_t i, uint32_t j) const {
+      return (words[i*num_words + (2*j)/64] >> ((2*j) % 64)) & 1;
+    }
+
+    bool z(uint32_t i, uint32_t j) const {
+      return (words[i*num_words + (2*j + 1)/64] >> ((2*j + 1) % 64)) & 1;
+    }
+
+    void set(uint32_t i, uint32_t j, bool x, bool z) {
+      uint64_t* row = &words[i*num_words];
+      row[(2*j)/64] |= static_cast<uint64_t>(x) << ((2*j) % 64);
+      row[(2*j + 1)/64] |= static_cast<uint64_t>(z) << ((2*j + 1) % 64);
+    }
+
+    // Both columns of every qubit in qubits
+    std::vector<uint64_t> mask(const std::vector<uint32_t>& qubits) const {
+      std::vector<uint64_t> m(num_words, 0);
+      for (auto q : qubits) {
+        if (q >= num_qubits) {
+          throw std::invalid_argument("Qubit out of range of the stabilizer rows.");
+        }
+        m[(2*q)/64] |= 1ull << ((2*q) % 64);
+        m[(2*q + 1)/64] |= 1ull << ((2*q + 1) % 64);
+      }
+
+      return m;
+    }
+
+    // GF(2) rank of the rows restricted to the columns in m. Works on its own copy of the rows, so that concurrent
+    // calls are safe.
+    uint32_t rank(const std::vector<uint64_t>& m) const {
+      std::vector<uint64_t> rows(words.size());
+      for (size_t i = 0; i < num_rows; i++) {
+        for (size_t w = 0; w < num_words; w++) {
+          rows[i*num_words + w] = words[i*num_words + w] & m[w];
+        }
+      }
+
+      uint32_t r = 0;
+      for (size_t w = 0; w < num_words && r < num_rows; w++) {
+        for (uint64_t bits = m[w]; bits && r < num_rows; bits &= bits - 1) {
+          uint64_t bit = bits & -bits;
+
+          uint32_t k = r;
+          while (k < num_rows && !(rows[k*num_words + w] & bit)) {
+            k++;
+          }
+          if (k == num_rows) {
+            continue;
+          }
+
+          uint64_t* pivot = &rows[r*num_words];
+          std::swap_ranges(pivot + w, pivot + num_words, &rows[k*num_words + w]);
+          for (uint32_t i = r + 1; i < num_rows; i++) {
+            uint64_t* row = &rows[i*num_words];
+            if (row[w] & bit) {
+              for (size_t v = w; v < num_words; v++) {
+                row[v] ^= pivot[v];
+              }
+            }
+          }
+          r++;
+        }
+      }
+
+      return r;
+    }
+
+    // Entropy of the qubits, which must be distinct. Of the k generators, the subsystem A retains the
+    // k - rank(rows restricted to the complement of A) independent ones supported in A, so
+    //   S(A) = |A| - k + rank(complement),
+    // which for a pure state equals rank(A) - |A|.
+    int entropy(const std::vector<uint32_t>& qubits) const {
+      std::vector<uint64_t> m = mask(qubits);
+      for (uint32_t j = 0; j < num_qubits; j++) {
+        m[(2*j)/64] ^= 1ull << ((2*j) % 64);
+        m[(2*j + 1)/64] ^= 1ull << ((2*j + 1) % 64);
+      }
+
+      return static_cast<int>(qubits.size()) - static_cast<int>(num_rows) + static_cast<int>(rank(m));
+    }
+
+    // Generators of the subgroup supported on the qubits [0, num_system), i.e. of the reduced state on them. The
+    // columns of the remaining qubits are eliminated once, and the rows left without support there are kept.
+    StabilizerRows restrict_to(uint32_t num_system) const {
+      StabilizerRows reduced = *this;
+      std::vector<uint64_t>& rows = reduced.words;
+      std::vector<bool> pivoted(num_rows, false);
+      for (uint32_t c = 2*num_system; c < 2*num_qubits; c++) {
+        size_t w = c/64;
+        uint64_t bit = 1ull << (c % 64);
+
+        uint32_t k = 0;
+        while (k < num_rows && (pivoted[k] || !(rows[k*num_words + w] & bit))) {
+          k++;
+        }
+        if (k == num_rows) {
+          continue;
+        }
+
+        pivoted[k] = true;
+        const uint64_t* pivot = &rows[k*num_words];
+        for (uint32_t i = 0; i < num_rows; i++) {
+          uint64_t* row = &rows[i*num_words];
+          if (!pivoted[i] && (row[w] & bit)) {
+            for (size_t v = 0; v < num_words; v++) {
+              row[v] ^= pivot[v];
+            }
+          }
+        }
+      }
+
+      StabilizerRows restricted(num_system, num_rows - std::count(pivoted.begin(), pivoted.end(), true));
+      uint32_t r = 0;
+      for (uint32_t i = 0; i < num_rows; i++) {
+        if (!pivoted[i]) {
+          for (uint32_t j = 0; j < num_system; j++) {
+            restricted.set(r, j, reduced.x(i, j), reduced.z(i, j));
+          }
+          r++;
+        }
+      }
+
+      return restricted;
+    }
+};
+
+// Entropies S([0, q)) for q = 0, ..., max_qubits of a pure stabilizer state on num_qubits qubits, whose generators are
+// given by stabilizer(i, j) -> (x, z), the Pauli on qubit j of generator i. Instead of an independent rank computation
+// per prefix, the generators are packed once and eliminated column by column in the order x_0, z_0, x_1, z_1, ...; the
+// rank of the generators restricted to [0, q) is the number of pivots among the first 2q columns, and
+// S([0, q)) = rank - q.
+template <typename F>
+std::vector<int> prefix_entropies(uint32_t num_qubits, uint32_t max_qubits, F&& stabilizer) {
+  size_t num_columns = 2*static_cast<size_t>(max_qubits);
+  size_t num_words = (num_columns + 63)/64;
+
+  std::vector<uint64_t> rows(num_qubits*num_words, 0);
+  for (uint32_t i = 0; i < num_qubits; i++) {
+    uint64_t* row = &rows[i*num_words];
+    for (uint32_t j = 0; j < max_qubits; j++) {
+      auto [x, z] = stabilizer(i, j);
+      row[(2*j)/64] |= static_cast<uint64_t>(x) << ((2*j) % 64);
+      row[(2*j + 1)/64] |= static_cast<uint64_t>(z) << ((2*j + 1) % 64);
+    }
+  }
+
+  // Generators which have not yet been used as a pivot
+  std::vector<uint32_t> active(num_qubits);
+  for (uint32_t i = 0; i < num_qubits; i++) {
+    active[i] = i;
+  }
+
+  std::vector<int> entropies(max_qubits + 1, 0);
+  int rank = 0;
+  for (size_t c = 0; c < num_columns; c++) {
+    size_t w = c / 64;
+    uint64_t mask = 1ull << (c % 64);
+
+    size_t k = 0;
+    while (k < active.size() && !(rows[active[k]*num_words + w] & mask)) {
+      k++;
+    }
+
+    if (k < active.size()) {
+      uint32_t pivot = active[k];
+      active[k] = active.back();
+      active.pop_back();
+      rank++;
+
+      // Only later columns matter for the remaining prefixes
+      const uint64_t* pivot_row = &rows[pivot*num_words];
+      for (auto i : active) {
+        uint64_t* row = &rows[i*num_words];
+        if (row[w] & mask) {
+          for (size_t v = w; v < num_words; v++) {
+            row[v] ^= pivot_row[v];
+          }
+        }
+      }
+    }
+
+    if (c % 2 == 1) {
+      uint32_t q = c/2 + 1;
+      entropies[q] = rank - static_cast<int>(q);
+    }
+  }
+
+  return entropies;
+}
+
+// Prefix entropies of a CHP state, read through the checked stabilizer rows of its tableau
+inline std::vector<int> prefix_entropies(QuantumCHPState& state, uint32_t max_qubits) {
+  StabilizerRows stabilizers(state);
+  return prefix_entropies(stabilizers.num_qubits, max_qubits, [&stabilizers](uint32_t i, uint32_t j) {
+    return std::make_pair(stabilizers.x(i, j), stabilizers.z(i, j));
+  });
+}
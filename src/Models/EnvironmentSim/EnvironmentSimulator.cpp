@@ -5,6 +5,24 @@
 using namespace dataframe;
 using namespace dataframe::utils;
 
+double SystemEntropyState::entanglement(const QubitSupport& support, uint32_t index) {
+	Qubits qubits = to_qubits(support);
+	std::vector<uint32_t> key(qubits.begin(), qubits.end());
+	std::sort(key.begin(), key.end());
+	if (!key.empty() && key.back() >= system_size) {
+		throw std::invalid_argument("Entropy queries in EnvironmentSimulator must be supported on the system qubits.");
+	}
+
+	auto it = cache.find(key);
+	if (it != cache.end()) {
+		return it->second;
+	}
+
+	double s = generators.entropy(key);
+	cache.emplace(std::move(key), s);
+	return s;
+}
+
 EnvironmentSimulator::EnvironmentSimulator(ExperimentParams &params, uint32_t) : Simulator(params), sampler(params) {
 	system_size = get<int>(params, "system_size");
 
@@ -14,6 +32,10 @@ EnvironmentSimulator::EnvironmentSimulator(ExperimentParams &params, uint32_t) :
 	if (env_dim == 1) {
 		env_size = system_size;
 	} else if (env_dim == 2) {
+		// The three environment columns of a system qubit must be distinct
+		if (system_size < 3) {
+			throw std::invalid_argument("2d environment interactions require a system size of at least 3.");
+		}
 		env_size = system_size*system_size;
 	} else {
 		throw std::invalid_argument("Environment interactions must be 1d or 2d.");
@@ -22,30 +44,54 @@ EnvironmentSimulator::EnvironmentSimulator(ExperimentParams &params, uint32_t) :
 	params.emplace("env_size", static_cast<double>(env_size));
 
 	state = std::make_shared<QuantumCHPState>(system_size + env_size);
+	system_state = std::make_shared<SystemEntropyState>(state, system_size);
 
 	offset = false;
 }
 
-void EnvironmentSimulator::one_dimensional_interactions() {
-	for (uint32_t i = 0; i < system_size; i++) {
-		for (uint32_t j = 0; j < env_size; j++) {
-			if (randf() < int_prob) {
-				std::vector<uint32_t> qubits{i, j};
-				state->random_clifford(qubits);
-			}
-		}
+// Calls f(k) for each k in [0, num_pairs) independently with probability int_prob, in increasing order, skipping a
+// geometric number of pairs between calls so that the cost scales with the number of interactions rather than pairs
+template <typename F>
+void EnvironmentSimulator::sample_interactions(uint64_t num_pairs, F&& f) {
+	if (int_prob <= 0.0) {
+		return;
+	}
+
+	double log_skip = std::log1p(-int_prob);
+	auto skip = [&]() -> double {
+		return (int_prob >= 1.0) ? 0.0 : std::floor(std::log(1.0 - randf())/log_skip);
+	};
+
+	double k = skip();
+	while (k < static_cast<double>(num_pairs)) {
+		f(static_cast<uint64_t>(k));
+		k += 1.0 + skip();
 	}
 }
 
+// Every system qubit may interact with every environment qubit
+void EnvironmentSimulator::one_dimensional_interactions() {
+	sample_interactions(static_cast<uint64_t>(system_size)*env_size, [this](uint64_t k) {
+		uint32_t i = k / env_size;
+		uint32_t j = k % env_size;
+		std::vector<uint32_t> qubits{i, system_size + j};
+		state->random_clifford(qubits);
+	});
+}
+
+// The environment is a system_size x system_size lattice, with column x lying beneath system qubit x. System qubit i
+// may interact with the environment qubits in columns i - 1, i and i + 1 (periodically), so that neighboring system
+// qubits share part of their environment.
 void EnvironmentSimulator::two_dimensional_interactions() {
-	for (uint32_t i = 0; i < system_size; i++) {
-		for (uint32_t j = 0; j < env_size; j++) {
-			if (randf() < int_prob) {
-				std::vector<uint32_t> qubits{i, j};
-				state->random_clifford(qubits);
-			}
-		}
-	}
+	uint32_t column_pairs = 3*system_size;
+	sample_interactions(static_cast<uint64_t>(system_size)*column_pairs, [this, column_pairs](uint64_t k) {
+		uint32_t i = k / column_pairs;
+		uint32_t r = k % column_pairs;
+		uint32_t x = (i + system_size + r / system_size - 1) % system_size;
+		uint32_t y = r % system_size;
+		std::vector<uint32_t> qubits{i, system_size + x*system_size + y};
+		state->random_clifford(qubits);
+	});
 }
 
 void EnvironmentSimulator::timesteps(uint32_t num_steps) {
@@ -73,6 +119,7 @@ void EnvironmentSimulator::timesteps(uint32_t num_steps) {
 
 SampleMap EnvironmentSimulator::take_samples() {
 	SampleMap samples;
-	sampler.add_samples(samples, state);
+	system_state->update();
+	sampler.add_samples(samples, system_state);
 	return samples;
 }
@@ -3,6 +3,36 @@
 #include <Simulator.hpp>
 #include <CliffordState.h>
 #include <Samplers.h>
+#include <PrefixEntropy.hpp>
+
+#include <map>
+
+// Entropies of subsets of the system qubits, which are the only ones queried by the entropy sampler. update() reads the
+// stabilizer rows of the system and environment once and eliminates the environment columns, leaving the generators
+// of the reduced state on the system; every query is then a rank over this smaller matrix. Stabilizer entropies do not
+// depend on the Renyi index, so each subsystem is evaluated once per update and shared between indices.
+class SystemEntropyState : public EntanglementEntropyState {
+	public:
+		std::shared_ptr<QuantumCHPState> state;
+
+		SystemEntropyState()=default;
+		SystemEntropyState(std::shared_ptr<QuantumCHPState> state, uint32_t system_size) : state(state), system_size(system_size) {
+			update();
+		}
+
+		virtual double entanglement(const QubitSupport& support, uint32_t index) override;
+
+		// Must be called whenever the state changes
+		void update() {
+			generators = StabilizerRows(*state).restrict_to(system_size);
+			cache.clear();
+		}
+
+	private:
+		uint32_t system_size = 0;
+		StabilizerRows generators{0, 0};
+		std::map<std::vector<uint32_t>, double> cache;
+};
 
 class EnvironmentSimulator : public Simulator {
 	private:
@@ -14,11 +44,15 @@ class EnvironmentSimulator : public Simulator {
 		uint32_t env_size;
 		
 		std::shared_ptr<QuantumCHPState> state;
+		std::shared_ptr<SystemEntropyState> system_state;
 
 		bool offset;
 
 		EntropySampler sampler;
 
+		template <typename F>
+		void sample_interactions(uint64_t num_pairs, F&& f);
+
 	public:
 		EnvironmentSimulator(dataframe::ExperimentParams& params, uint32_t);
 
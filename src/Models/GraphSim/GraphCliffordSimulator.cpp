@@ -34,6 +34,7 @@ GraphCliffordSimulator::GraphCliffordSimulator(ExperimentParams &params, uint32_
 	}
 
 	state = std::make_shared<QuantumGraphState>(system_size);
+	components = GraphComponents(system_size);
 
 	if (evolution_type == QUANTUM_AUTOMATON) { // quantum automaton circuit must be polarized
 		for (uint32_t i = 0; i < system_size; i++) {
@@ -108,30 +109,110 @@ void GraphCliffordSimulator::unitary_timesteps(uint32_t num_steps) {
 	initial_offset = offset_layer;
 }
 
+static inline void sum_tree_add(std::vector<double>& tree, uint32_t k, double v) {
+	for (k++; k < tree.size(); k += k & -k) {
+		tree[k] += v;
+	}
+}
+
+static inline double sum_tree_total(const std::vector<double>& tree) {
+	double total = 0.0;
+	for (uint32_t k = tree.size() - 1; k > 0; k -= k & -k) {
+		total += tree[k];
+	}
+
+	return total;
+}
+
+// Smallest k such that the weights of leaves 0..k sum past r
+static inline uint32_t sum_tree_search(const std::vector<double>& tree, double r) {
+	uint32_t n = tree.size() - 1;
+	uint32_t mask = 1;
+	while (2*mask <= n) {
+		mask *= 2;
+	}
+
+	uint32_t pos = 0;
+	for (; mask > 0; mask >>= 1) {
+		uint32_t next = pos + mask;
+		if (next <= n && r >= tree[next]) {
+			r -= tree[next];
+			pos = next;
+		}
+	}
+
+	return std::min(pos, n - 1);
+}
+
 void GraphCliffordSimulator::generate_random_graph() {
 	Graph<int> graph(system_size);
 
+	// The attachment weight dist(i, j)^a only depends on the offset j - i, so a single sum tree over the offsets
+	// 1, ..., L - 1 serves every vertex. While vertex i draws, its existing neighbors and the partners it has already
+	// drawn are zeroed in the tree, and restored afterwards.
+	uint32_t num_offsets = system_size - 1;
+	std::vector<double> kernel(system_size/2 + 1, 0.0);
+	for (uint32_t d = 1; d < kernel.size(); d++) {
+		kernel[d] = std::pow(d, a);
+		if (!(kernel[d] > 0.0) || std::isinf(kernel[d])) {
+			throw std::invalid_argument(fmt::format("Attachment weight dist^a is not a positive finite number at dist = {} for a = {}.", d, a));
+		}
+	}
+
+	std::vector<double> offset_weights(num_offsets);
+	std::vector<double> tree(num_offsets + 1, 0.0);
+	for (uint32_t k = 0; k < num_offsets; k++) {
+		offset_weights[k] = kernel[dist(0, k + 1)];
+		sum_tree_add(tree, k, offset_weights[k]);
+	}
+
+	std::vector<bool> excluded(num_offsets, false);
+	std::vector<uint32_t> zeroed;
+	auto exclude = [&](uint32_t k) {
+		if (!excluded[k]) {
+			excluded[k] = true;
+			sum_tree_add(tree, k, -offset_weights[k]);
+			zeroed.push_back(k);
+		}
+	};
+
 	// Barabasi-Albert random graph model
 	for (uint32_t i = 0; i < system_size; i++) {
-		std::vector<float> weights;
-		std::vector<uint32_t> sites;
-		for (uint32_t j = 0; j < system_size; j++) {
-			if (i == j || graph.contains_edge(i, j)) {
-				continue;
+		zeroed.clear();
+		for (auto const j : graph.neighbors(i)) {
+			exclude((j + system_size - i) % system_size - 1);
+		}
+
+		for (uint32_t t = 0; t < m && zeroed.size() < num_offsets; t++) {
+			uint32_t k = sum_tree_search(tree, std::uniform_real_distribution<double>(0.0, sum_tree_total(tree))(rng));
+
+			// Rounding in the tree can leave a little weight on excluded offsets; if one is hit, draw exactly among the
+			// remaining offsets instead
+			if (excluded[k]) {
+				double remaining = 0.0;
+				for (uint32_t l = 0; l < num_offsets; l++) {
+					remaining += excluded[l] ? 0.0 : offset_weights[l];
+				}
+
+				double r = std::uniform_real_distribution<double>(0.0, remaining)(rng);
+				for (uint32_t l = 0; l < num_offsets; l++) {
+					if (!excluded[l]) {
+						k = l;
+						if (r < offset_weights[l]) {
+							break;
+						}
+						r -= offset_weights[l];
+					}
+				}
 			}
 
-			weights.push_back(std::pow(dist(i, j), a));
-			sites.push_back(j);
+			graph.add_edge(i, (i + k + 1) % system_size);
+			exclude(k);
 		}
 
-		
-		for (uint32_t j = 0; j < m; j++) {
-			std::discrete_distribution<uint32_t> distribution(weights.begin(), weights.end());
-			uint32_t k = distribution(rng);
-			graph.add_edge(i, k);
-
-			weights.erase(weights.begin() + k);
-			sites.erase(sites.begin() + k);
+		for (auto const k : zeroed) {
+			excluded[k] = false;
+			sum_tree_add(tree, k, offset_weights[k]);
 		}
 	}
 
@@ -139,6 +220,8 @@ void GraphCliffordSimulator::generate_random_graph() {
 }
 
 void GraphCliffordSimulator::timesteps(uint32_t num_steps) {
+	components.invalidate();
+
 	if (evolution_type == RANDOM_CLIFFORD) {
 		rc_timesteps(num_steps);
 	} else if (evolution_type == QUANTUM_AUTOMATON) {
@@ -219,8 +302,8 @@ SampleMap GraphCliffordSimulator::take_samples() {
 	add_degree_distribution(samples);
 
   dataframe::utils::emplace(samples, "global_clustering_coefficient", state->graph.global_clustering_coefficient());
-	dataframe::utils::emplace(samples, "average_cluster_size", state->graph.average_component_size());
-	dataframe::utils::emplace(samples, "max_cluster_size", state->graph.max_component_size());
+	dataframe::utils::emplace(samples, "average_cluster_size", components.average_component_size(state->graph));
+	dataframe::utils::emplace(samples, "max_cluster_size", components.max_component_size(state->graph));
 
 	return samples;
 }
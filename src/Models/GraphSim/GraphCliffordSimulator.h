@@ -4,6 +4,8 @@
 #include <CliffordState.h>
 #include <Samplers.h>
 
+#include <GraphComponents.hpp>
+
 class GraphCliffordSimulator : public Simulator {
 	private:
 		uint32_t system_size;
@@ -23,6 +25,8 @@ class GraphCliffordSimulator : public Simulator {
 
 		EntropySampler sampler;
 
+		GraphComponents components;
+
 		void mzr(uint32_t q);
 
 		void unitary_timesteps(uint32_t num_steps);
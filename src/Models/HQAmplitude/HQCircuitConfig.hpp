@@ -3,27 +3,473 @@
 #include <Frame.h>
 #include <LinearCode.h>
 
+#include <algorithm>
 #include <unordered_set>
+#include <map>
 #include <memory>
+#include <bit>
+#include <thread>
 
-static BinaryPolynomial cx_on_poly(const BinaryPolynomial& poly, size_t i, size_t j) {
-  std::vector<BinaryPolynomialTerm> terms;
-  for (auto const& term : poly.terms) {
-    if (term.contains_ind(j)) {
-      BinaryPolynomialTerm t1(term);
-      BinaryPolynomialTerm t2(term);
-      size_t k = std::distance(term.inds.begin(), std::find(term.inds.begin(), term.inds.end(), j));
-      t2.inds[k] = i;
-      terms.push_back(t1.reduce());
-      terms.push_back(t2.reduce());
-    } else {
-      terms.push_back(term);
+// Polynomial over GF(2) with each monomial stored as a bitmask in a hash set, so that adding a term which is
+// already present cancels it. Each variable additionally indexes the monomials containing it, so that a CX
+// substitution only touches the affected monomials.
+class HashedBinaryPolynomial {
+  public:
+    using Monomial = std::vector<uint64_t>;
+
+    size_t n;
+
+    HashedBinaryPolynomial(size_t n) : n(n), num_words((n + 63)/64), occurrences(n) {}
+
+    void add_term(const std::vector<size_t>& inds) {
+      Monomial monomial(num_words, 0);
+      for (auto const i : inds) {
+        monomial[i / 64] |= 1ull << (i % 64);
+      }
+
+      toggle(monomial);
+    }
+
+    // Substitutes x_j -> x_j + x_i, as produced by a CX with control i and target j
+    void cx(size_t i, size_t j) {
+      std::vector<Monomial> affected(occurrences[j].begin(), occurrences[j].end());
+      for (auto monomial : affected) {
+        monomial[j / 64] &= ~(1ull << (j % 64));
+        monomial[i / 64] |= 1ull << (i % 64);
+        toggle(monomial);
+      }
+    }
+
+    BinaryPolynomial to_polynomial() const {
+      BinaryPolynomial poly(n);
+      for (auto const& monomial : terms) {
+        poly.add_term(inds_of(monomial));
+      }
+
+      return poly;
+    }
+
+  private:
+    struct MonomialHash {
+      size_t operator()(const Monomial& monomial) const {
+        size_t h = 0;
+        for (auto const w : monomial) {
+          h ^= std::hash<uint64_t>{}(w) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        }
+        return h;
+      }
+    };
+
+    size_t num_words;
+    std::unordered_set<Monomial, MonomialHash> terms;
+    std::vector<std::unordered_set<Monomial, MonomialHash>> occurrences;
+
+    std::vector<size_t> inds_of(const Monomial& monomial) const {
+      std::vector<size_t> inds;
+      for (size_t w = 0; w < num_words; w++) {
+        uint64_t bits = monomial[w];
+        while (bits) {
+          inds.push_back(64*w + std::countr_zero(bits));
+          bits &= bits - 1;
+        }
+      }
+
+      return inds;
+    }
+
+    void toggle(const Monomial& monomial) {
+      bool present = terms.erase(monomial);
+      if (!present) {
+        terms.insert(monomial);
+      }
+
+      for (auto const i : inds_of(monomial)) {
+        if (present) {
+          occurrences[i].erase(monomial);
+        } else {
+          occurrences[i].insert(monomial);
+        }
+      }
     }
+};
+
+// Splits [0, s) into at most num_threads contiguous chunks and calls f(chunk, start, stop) on each in parallel.
+template <typename F>
+static void parallel_for_chunks(uint64_t s, uint32_t num_threads, F&& f) {
+  uint64_t num_chunks = std::max<uint64_t>(1, std::min<uint64_t>(num_threads, s));
+  if (num_chunks == 1) {
+    f(0, 0, s);
+    return;
+  }
+
+  std::vector<std::thread> threads;
+  for (uint64_t c = 0; c < num_chunks; c++) {
+    uint64_t start = c*s/num_chunks;
+    uint64_t stop = (c + 1)*s/num_chunks;
+    threads.emplace_back([&f, c, start, stop]() { f(c, start, stop); });
   }
 
-  return BinaryPolynomial(terms, poly.n);
+  for (auto& thread : threads) {
+    thread.join();
+  }
 }
 
+// Computes the normalized Walsh-Hadamard coefficient sum_z (-1)^f(z) / 2^n of a polynomial over GF(2).
+// Variables which do not appear in any term contribute trivially and are dropped. The first six remaining
+// variables are bit-sliced across the 64 lanes of a word, and the remaining variables are enumerated in
+// Gray-code order, so that each step only updates the terms which contain the flipped variable.
+class BitslicedPolynomialEvaluator {
+  public:
+    BitslicedPolynomialEvaluator(const BinaryPolynomial& poly) {
+      std::vector<int64_t> labels(poly.n, -1);
+      num_vars = 0;
+      for (auto const& term : poly.terms) {
+        std::vector<size_t> inds;
+        for (auto const i : term.inds) {
+          if (labels[i] == -1) {
+            labels[i] = num_vars++;
+          }
+          inds.push_back(labels[i]);
+        }
+        terms.push_back(inds);
+      }
+
+      if (num_vars > 63 + LANE_VARS) {
+        throw std::invalid_argument("Too many variables for exact amplitude calculation.");
+      }
+
+      num_low = std::min(num_vars, LANE_VARS);
+      num_high = num_vars - num_low;
+      num_lanes = 1u << num_low;
+      lane_mask = (num_lanes == 64) ? ~0ull : ((1ull << num_lanes) - 1);
+
+      high_terms = std::vector<std::vector<size_t>>(num_high);
+      for (size_t t = 0; t < terms.size(); t++) {
+        for (auto const i : terms[t]) {
+          if (i >= num_low) {
+            high_terms[i - num_low].push_back(t);
+          }
+        }
+      }
+    }
+
+    double amplitude() const {
+      uint64_t s = 1ull << num_high;
+      return double(partial_sum(0, s))/std::pow(2.0, num_vars);
+    }
+
+  private:
+    static constexpr size_t LANE_VARS = 6;
+    static constexpr uint64_t LANE_PATTERNS[LANE_VARS] = {
+      0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+      0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull
+    };
+
+    size_t num_vars;
+    size_t num_low;
+    size_t num_high;
+    uint32_t num_lanes;
+    uint64_t lane_mask;
+
+    std::vector<std::vector<size_t>> terms;
+    std::vector<std::vector<size_t>> high_terms;
+
+    inline uint64_t term_word(size_t t, uint64_t high) const {
+      uint64_t w = ~0ull;
+      for (auto const i : terms[t]) {
+        if (i < num_low) {
+          w &= LANE_PATTERNS[i];
+        } else if (!((high >> (i - num_low)) & 1)) {
+          return 0ull;
+        }
+      }
+
+      return w;
+    }
+
+    // Sums (-1)^f over the Gray codes of [start, stop) for the high variables and all lanes
+    int64_t partial_sum(uint64_t start, uint64_t stop) const {
+      uint64_t high = start ^ (start >> 1);
+      uint64_t f = 0ull;
+      for (size_t t = 0; t < terms.size(); t++) {
+        f ^= term_word(t, high);
+      }
+
+      int64_t total = 0;
+      for (uint64_t x = start; x < stop; x++) {
+        total += int64_t(num_lanes) - 2*std::popcount(f & lane_mask);
+        if (x + 1 == stop) {
+          break;
+        }
+
+        // Moving from gray(x) to gray(x + 1) flips a single variable v; every term containing v
+        // toggles by the product of its other variables.
+        size_t v = std::countr_zero(x + 1);
+        uint64_t with_v = high | (1ull << v);
+        for (auto const t : high_terms[v]) {
+          f ^= term_word(t, with_v);
+        }
+        high ^= 1ull << v;
+      }
+
+      return total;
+    }
+};
+
+// Partial evaluations of a polynomial on a fixed subset of its variables. Terms are grouped by their remaining
+// indices so that duplicates cancel, and the state lives in a reusable Workspace which can be updated one
+// fixed variable at a time; in Gray-code order consecutive evaluations only touch the terms containing the
+// flipped variable.
+class PartialPolynomialEvaluator {
+  public:
+    struct Workspace {
+      std::vector<uint32_t> num_unset;
+      std::vector<uint8_t> parity;
+      BinaryPolynomial poly;
+
+      Workspace(size_t n) : poly(n) {}
+    };
+
+    PartialPolynomialEvaluator(const BinaryPolynomial& poly, const std::vector<size_t>& inds) : n(poly.n), num_fixed(inds.size()) {
+      std::vector<int64_t> positions(poly.n, -1);
+      for (size_t j = 0; j < inds.size(); j++) {
+        positions[inds[j]] = j;
+      }
+
+      std::map<std::vector<size_t>, size_t> ids;
+      terms_of_fixed = std::vector<std::vector<size_t>>(num_fixed);
+      for (auto const& term : poly.terms) {
+        size_t t = term_fixed.size();
+        std::vector<size_t> fixed;
+        std::vector<size_t> remaining;
+        for (auto const i : term.inds) {
+          if (positions[i] != -1) {
+            fixed.push_back(positions[i]);
+            terms_of_fixed[positions[i]].push_back(t);
+          } else {
+            remaining.push_back(i);
+          }
+        }
+
+        std::vector<size_t> key(remaining);
+        std::sort(key.begin(), key.end());
+        auto [it, inserted] = ids.emplace(key, reduced_terms.size());
+        if (inserted) {
+          BinaryPolynomialTerm reduced(term);
+          reduced.inds = remaining;
+          reduced_terms.push_back(reduced);
+        }
+
+        term_ids.push_back(it->second);
+        term_fixed.push_back(fixed);
+      }
+    }
+
+    Workspace make_workspace() const {
+      return Workspace(n);
+    }
+
+    // Fixes inds[j] = (z >> j) & 1
+    void set(Workspace& workspace, uint64_t z) const {
+      set(workspace, [z](size_t j) { return bool((z >> j) & 1); });
+    }
+
+    void set(Workspace& workspace, const BitString& bits) const {
+      set(workspace, [&bits](size_t j) { return bool(bits[j]); });
+    }
+
+    // Changes inds[j] to value, which must differ from its current value
+    void flip(Workspace& workspace, size_t j, bool value) const {
+      for (auto const t : terms_of_fixed[j]) {
+        bool was_active = workspace.num_unset[t] == 0;
+        if (value) {
+          workspace.num_unset[t]--;
+        } else {
+          workspace.num_unset[t]++;
+        }
+
+        if (was_active != (workspace.num_unset[t] == 0)) {
+          workspace.parity[term_ids[t]] ^= 1;
+        }
+      }
+    }
+
+    const BinaryPolynomial& polynomial(Workspace& workspace) const {
+      workspace.poly.terms.clear();
+      for (size_t id = 0; id < reduced_terms.size(); id++) {
+        if (workspace.parity[id]) {
+          workspace.poly.terms.push_back(reduced_terms[id]);
+        }
+      }
+
+      return workspace.poly;
+    }
+
+  private:
+    size_t n;
+    size_t num_fixed;
+
+    std::vector<BinaryPolynomialTerm> reduced_terms;
+    std::vector<size_t> term_ids;
+    std::vector<std::vector<size_t>> term_fixed;
+    std::vector<std::vector<size_t>> terms_of_fixed;
+
+    template <typename Bits>
+    void set(Workspace& workspace, Bits&& bits) const {
+      workspace.num_unset = std::vector<uint32_t>(term_ids.size(), 0);
+      workspace.parity = std::vector<uint8_t>(reduced_terms.size(), 0);
+      for (size_t t = 0; t < term_ids.size(); t++) {
+        for (auto const j : term_fixed[t]) {
+          if (!bits(j)) {
+            workspace.num_unset[t]++;
+          }
+        }
+
+        if (workspace.num_unset[t] == 0) {
+          workspace.parity[term_ids[t]] ^= 1;
+        }
+      }
+    }
+};
+
+// Row-reduced factorization E*A = R of an m x m matrix over GF(2), with rows packed into 64-bit words.
+// Once factorized, consistency checks and particular solutions of A*x = v only require applying E and
+// reading off the pivots of R. The factorization is kept until it is asked to factorize a different matrix.
+class GF2Factorization {
+  public:
+    size_t m;
+    size_t num_words;
+
+    GF2Factorization(size_t m) : m(m), num_words((m + 63)/64), factorized(false) {}
+
+    static inline bool get_bit(const uint64_t* v, size_t i) {
+      return (v[i / 64] >> (i % 64)) & 1;
+    }
+
+    static inline void flip_bit(uint64_t* v, size_t i) {
+      v[i / 64] ^= 1ull << (i % 64);
+    }
+
+    // Expects matrix as m rows of num_words words. Returns true if the factorization was recomputed.
+    bool factorize(const std::vector<uint64_t>& matrix) {
+      if (factorized && matrix == A) {
+        return false;
+      }
+
+      A = matrix;
+      R = matrix;
+      E = std::vector<uint64_t>(m*num_words, 0);
+      for (size_t i = 0; i < m; i++) {
+        flip_bit(row(E, i), i);
+      }
+
+      pivots.clear();
+      size_t r = 0;
+      for (size_t c = 0; c < m && r < m; c++) {
+        size_t p = r;
+        while (p < m && !get_bit(row(R, p), c)) {
+          p++;
+        }
+
+        if (p == m) {
+          continue;
+        }
+
+        if (p != r) {
+          std::swap_ranges(row(R, p), row(R, p) + num_words, row(R, r));
+          std::swap_ranges(row(E, p), row(E, p) + num_words, row(E, r));
+        }
+
+        for (size_t i = 0; i < m; i++) {
+          if (i != r && get_bit(row(R, i), c)) {
+            for (size_t w = 0; w < num_words; w++) {
+              row(R, i)[w] ^= row(R, r)[w];
+              row(E, i)[w] ^= row(E, r)[w];
+            }
+          }
+        }
+
+        pivots.push_back(c);
+        r++;
+      }
+
+      factorized = true;
+      return true;
+    }
+
+    size_t rank() const {
+      return pivots.size();
+    }
+
+    bool in_col_space(const std::vector<uint64_t>& v) const {
+      std::vector<uint64_t> y = apply_transform(v);
+      for (size_t r = rank(); r < m; r++) {
+        if (get_bit(y.data(), r)) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+
+    bool in_row_space(const std::vector<uint64_t>& v) const {
+      std::vector<uint64_t> w(v);
+      for (size_t r = 0; r < rank(); r++) {
+        if (get_bit(w.data(), pivots[r])) {
+          for (size_t i = 0; i < num_words; i++) {
+            w[i] ^= row(R, r)[i];
+          }
+        }
+      }
+
+      return std::all_of(w.begin(), w.end(), [](uint64_t x) { return x == 0; });
+    }
+
+    // Particular solution of A*x = v with free variables set to zero; assumes v is in the column space
+    std::vector<uint64_t> solve(const std::vector<uint64_t>& v) const {
+      std::vector<uint64_t> y = apply_transform(v);
+      std::vector<uint64_t> x(num_words, 0);
+      for (size_t r = 0; r < rank(); r++) {
+        if (get_bit(y.data(), r)) {
+          flip_bit(x.data(), pivots[r]);
+        }
+      }
+
+      return x;
+    }
+
+  private:
+    bool factorized;
+    std::vector<uint64_t> A;
+    std::vector<uint64_t> R;
+    std::vector<uint64_t> E;
+    std::vector<size_t> pivots;
+
+    inline uint64_t* row(std::vector<uint64_t>& M, size_t i) {
+      return M.data() + i*num_words;
+    }
+
+    inline const uint64_t* row(const std::vector<uint64_t>& M, size_t i) const {
+      return M.data() + i*num_words;
+    }
+
+    std::vector<uint64_t> apply_transform(const std::vector<uint64_t>& v) const {
+      std::vector<uint64_t> y(num_words, 0);
+      for (size_t i = 0; i < m; i++) {
+        uint32_t parity = 0;
+        for (size_t w = 0; w < num_words; w++) {
+          parity += std::popcount(row(E, i)[w] & v[w]);
+        }
+
+        if (parity & 1) {
+          flip_bit(y.data(), i);
+        }
+      }
+
+      return y;
+    }
+};
+
 class HQCircuitConfig {
   public:
     HQCircuitConfig(dataframe::ExperimentParams& params) {
@@ -41,64 +487,59 @@ class HQCircuitConfig {
     }
 
     double calculate_amplitude(const BinaryPolynomial& poly) const {
+      GF2Factorization factorization(m);
+      return calculate_amplitude(poly, factorization);
+    }
+
+    // Reuses the factorization of gamma between calls when gamma has not changed
+    double calculate_amplitude(const BinaryPolynomial& poly, GF2Factorization& factorization) const {
       if (calculation_type == 0) {
         // Explicit sum over every element
-        uint64_t s = 1u << poly.n;
-        double I = 0.0;
-        uint32_t positive = 0;
-        for (uint64_t z = 0; z < s; z++) {
-          BitString bits = BitString::from_bits(poly.n, z);
-          if (poly.evaluate(bits)) {
-            positive++;
-          }
-          I += std::pow(-1.0, poly.evaluate(bits));
-        }
-
-        return I/s;
+        BitslicedPolynomialEvaluator evaluator(poly);
+        return evaluator.amplitude();
       } else if (calculation_type == 1) {
         // Use linear algebra technique in IBM paper
-        BinaryMatrix gamma(m, m);
-        for (size_t i = 0; i < m; i++) {
-          for (size_t j = 0; j < m; j++) {
-            size_t ib = 3*i + 1;
-            size_t ig = 3*j + 2;
-            std::vector<size_t> inds{ib, ig};
-            if (poly.contains_term(inds)) {
-              gamma.set(i, j, 1);
+        size_t num_words = factorization.num_words;
+        std::vector<uint64_t> gamma(m*num_words, 0);
+        std::vector<uint64_t> delta_g(num_words, 0);
+        std::vector<uint64_t> delta_b(num_words, 0);
+        bool f0 = false;
+
+        // Single pass over the terms; b and g variables are indexed by 3*i + 1 and 3*i + 2
+        for (auto const& term : poly.terms) {
+          if (term.inds.size() == 0) {
+            f0 ^= 1;
+          } else if (term.inds.size() == 1) {
+            size_t i = term.inds[0];
+            if (i % 3 == 1) {
+              GF2Factorization::flip_bit(delta_b.data(), i / 3);
+            } else if (i % 3 == 2) {
+              GF2Factorization::flip_bit(delta_g.data(), i / 3);
+            }
+          } else if (term.inds.size() == 2) {
+            size_t i1 = term.inds[0];
+            size_t i2 = term.inds[1];
+            if (i1 % 3 == 2) {
+              std::swap(i1, i2);
             }
-          }
-        }
-
-        std::vector<bool> delta_g(m);
-        std::vector<bool> delta_b(m);
-
-        for (size_t i = 0; i < m; i++) {
-          std::vector<size_t> ind(1);
-
-          size_t ib = 3*i + 1;
-          ind[0] = ib;
-          if (poly.contains_term(ind)) {
-            delta_b[i] = 1;
-          }
 
-          size_t ig = 3*i + 2;
-          ind[0] = ig;
-          if (poly.contains_term(ind)) {
-            delta_g[i] = 1;
+            if (i1 % 3 == 1 && i2 % 3 == 2) {
+              GF2Factorization::flip_bit(gamma.data() + (i1 / 3)*num_words, i2 / 3);
+            }
           }
         }
 
-        if (gamma.in_col_space(delta_g) && gamma.in_row_space(delta_b)) {
-          std::vector<bool> solution = gamma.solve_linear_system(delta_g);
-          bool r = false;
-          for (size_t i = 0; i < m; i++) {
-            r ^= delta_b[i] & solution[i];
+        factorization.factorize(gamma);
+
+        if (factorization.in_col_space(delta_g) && factorization.in_row_space(delta_b)) {
+          std::vector<uint64_t> solution = factorization.solve(delta_g);
+          uint32_t r = 0;
+          for (size_t w = 0; w < num_words; w++) {
+            r += std::popcount(delta_b[w] & solution[w]);
           }
 
-          uint32_t rank = gamma.rank();
-          int f0 = poly.evaluate(BitString(poly.n));
-          double sign = std::pow(-1.0, double(r) + f0);
-          return sign/(1u << rank);
+          double sign = std::pow(-1.0, double(r & 1) + f0);
+          return sign/std::pow(2.0, factorization.rank());
         } else {
           return 0.0;
         }
@@ -108,7 +549,7 @@ class HQCircuitConfig {
     }
 
     BinaryPolynomial generate_hq_polynomial() {
-      BinaryPolynomial poly(num_qubits);
+      HashedBinaryPolynomial poly(num_qubits);
 
       std::unordered_set<size_t> s1;
       for (size_t q = 0; q < num_qubits; q++) {
@@ -177,12 +618,12 @@ class HQCircuitConfig {
 
         for (auto const& [q1, q2] : partners) {
           for (size_t j = 0; j < 3; j++) {
-            poly = cx_on_poly(poly, 3*q1 + j, 3*q2 + j);
+            poly.cx(3*q1 + j, 3*q2 + j);
           }
         }
       }
 
-      return poly;
+      return poly.to_polynomial();
     }
 
     dataframe::DataSlide compute(uint32_t num_threads) {
@@ -196,28 +637,50 @@ class HQCircuitConfig {
           inds[i] = 3*i;
         }
 
+        PartialPolynomialEvaluator evaluator(poly, inds);
+
         std::vector<double> amplitudes;
         if (num_samples == 0) {
-          // Exact calculation (every bitstring)
-          uint64_t s = 1u << m;
+          // Exact calculation (every bitstring), visited in Gray-code order so that consecutive
+          // partial evaluations differ by a single variable
+          uint64_t s = 1ull << m;
           amplitudes = std::vector<double>(s);
-          for (uint64_t z = 0; z < s; z++) {
-            BitString bits = BitString::from_bits(m, z);
-            BinaryPolynomial poly_z = poly.partial_evaluate(bits, inds);
-            amplitudes[z] = calculate_amplitude(poly_z);
-          }
+          parallel_for_chunks(s, num_threads, [this, &evaluator, &amplitudes](uint64_t, uint64_t start, uint64_t stop) {
+            auto workspace = evaluator.make_workspace();
+            GF2Factorization factorization(m);
+            uint64_t z = start ^ (start >> 1);
+            evaluator.set(workspace, z);
+            for (uint64_t x = start; x < stop; x++) {
+              amplitudes[z] = calculate_amplitude(evaluator.polynomial(workspace), factorization);
+              if (x + 1 == stop) {
+                break;
+              }
+
+              size_t v = std::countr_zero(x + 1);
+              z ^= 1ull << v;
+              evaluator.flip(workspace, v, (z >> v) & 1);
+            }
+          });
         } else {
           // Monte-Carlo calculation
-          amplitudes = std::vector<double>(num_samples);
+          std::vector<BitString> samples;
           for (uint32_t i = 0; i < num_samples; i++) {
             BitString bits(m);
             for (size_t j = 0; j < bits.size(); j++) {
               bits[j] = randi();
             }
-
-            BinaryPolynomial poly_z = poly.partial_evaluate(bits, inds);
-            amplitudes[i] = calculate_amplitude(poly_z);
+            samples.push_back(bits);
           }
+
+          amplitudes = std::vector<double>(num_samples);
+          parallel_for_chunks(num_samples, num_threads, [this, &evaluator, &samples, &amplitudes](uint64_t, uint64_t start, uint64_t stop) {
+            auto workspace = evaluator.make_workspace();
+            GF2Factorization factorization(m);
+            for (uint64_t i = start; i < stop; i++) {
+              evaluator.set(workspace, samples[i]);
+              amplitudes[i] = calculate_amplitude(evaluator.polynomial(workspace), factorization);
+            }
+          });
         }
 
         all_amplitudes.resize(all_amplitudes.size() + amplitudes.size(), 0);
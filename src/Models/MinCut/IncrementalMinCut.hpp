@@ -0,0 +1,270 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+// Minimum cut between two vertex sets A and B of a growing undirected graph with unit edge capacities. The flow is
+// kept between queries: a query only repairs the vertices whose terminal status changed and then pushes augmenting
+// paths from A to B in the residual graph. Moving a vertex directly between A and B leaves the flow feasible, so
+// sweeping a cut one vertex at a time costs a few augmentations per step. A vertex which stops being a terminal has
+// its imbalance extended to a terminal of the same side where possible, so that moving the terminals to a newly added
+// row carries the flow over through the new edges, and cancelled otherwise; added edges start with zero flow. Old
+// vertices can be discarded from the front, keeping the flow on the surviving edges.
+class IncrementalMinCut {
+  public:
+    IncrementalMinCut(uint32_t num_vertices=0) : adjacency(num_vertices), side(num_vertices, NONE) {}
+
+    uint32_t num_vertices() const {
+      return adjacency.size();
+    }
+
+    uint32_t add_vertex() {
+      adjacency.push_back({});
+      side.push_back(NONE);
+      return adjacency.size() - 1;
+    }
+
+    void add_edge(uint32_t u, uint32_t v) {
+      uint32_t e = edges.size();
+      edges.push_back({u, v, 0});
+      adjacency[u].push_back(e);
+      adjacency[v].push_back(e);
+    }
+
+    // Removes vertices 0, ..., k - 1 together with their edges and relabels vertex v as v - k. Non-terminal vertices
+    // which lose flow-carrying edges are rebalanced, so that the remaining flow stays feasible.
+    void remove_front(uint32_t k) {
+      uint32_t n = num_vertices();
+      if (k > n) {
+        throw std::invalid_argument("Cannot remove more vertices than are present.");
+      }
+
+      std::vector<Edge> kept;
+      for (auto const& edge : edges) {
+        if (edge.u >= k && edge.v >= k) {
+          kept.push_back({edge.u - k, edge.v - k, edge.flow});
+        }
+      }
+
+      edges = kept;
+      adjacency = std::vector<std::vector<uint32_t>>(n - k);
+      for (uint32_t e = 0; e < edges.size(); e++) {
+        adjacency[edges[e].u].push_back(e);
+        adjacency[edges[e].v].push_back(e);
+      }
+      side.erase(side.begin(), side.begin() + k);
+
+      for (uint32_t v = 0; v < num_vertices(); v++) {
+        if (side[v] == NONE) {
+          balance(v);
+        }
+      }
+    }
+
+    // Value of the minimum cut separating a from b
+    uint32_t min_cut(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+      std::vector<uint8_t> new_side(num_vertices(), NONE);
+      for (auto v : a) {
+        new_side[v] = SOURCE;
+      }
+      for (auto v : b) {
+        if (new_side[v] == SOURCE) {
+          throw std::invalid_argument("Subsystems of a cut must be disjoint.");
+        }
+        new_side[v] = SINK;
+      }
+
+      std::vector<uint32_t> released;
+      for (uint32_t v = 0; v < num_vertices(); v++) {
+        if (side[v] != NONE && new_side[v] == NONE) {
+          released.push_back(v);
+        }
+      }
+      side = new_side;
+
+      for (auto v : released) {
+        balance(v);
+      }
+
+      while (augment()) {}
+
+      int value = 0;
+      for (auto v : a) {
+        value -= excess(v);
+      }
+
+      return value;
+    }
+
+    std::string to_string() const {
+      std::string s;
+      for (uint32_t v = 0; v < num_vertices(); v++) {
+        s += std::to_string(v) + " -> ";
+        for (auto e : adjacency[v]) {
+          s += std::to_string(other(e, v)) + " ";
+        }
+        s += "\n";
+      }
+
+      return s;
+    }
+
+  private:
+    static constexpr uint8_t NONE = 0;
+    static constexpr uint8_t SOURCE = 1;
+    static constexpr uint8_t SINK = 2;
+
+    // Flow is measured from u to v and lies in {-1, 0, 1}
+    struct Edge {
+      uint32_t u;
+      uint32_t v;
+      int flow;
+    };
+
+    std::vector<Edge> edges;
+    std::vector<std::vector<uint32_t>> adjacency;
+    std::vector<uint8_t> side;
+
+    inline uint32_t other(uint32_t e, uint32_t v) const {
+      return edges[e].u == v ? edges[e].v : edges[e].u;
+    }
+
+    // Flow from v to its neighbor along e
+    inline int flow_from(uint32_t e, uint32_t v) const {
+      return edges[e].u == v ? edges[e].flow : -edges[e].flow;
+    }
+
+    inline void push(uint32_t e, uint32_t v, int f) {
+      edges[e].flow += (edges[e].u == v) ? f : -f;
+    }
+
+    // Net flow into v
+    int excess(uint32_t v) const {
+      int x = 0;
+      for (auto e : adjacency[v]) {
+        x -= flow_from(e, v);
+      }
+
+      return x;
+    }
+
+    // Restores conservation at a vertex which is no longer a terminal. Each unit of imbalance is first extended to a
+    // terminal of the same side along a residual path, which keeps the value of the flow: when the cut moves to a new
+    // row, the flow which ended at the old row is continued into the new one. Only if no such path exists is the unit
+    // cancelled instead: surplus inflow is walked backwards along flow-carrying edges, cancelling the flow on each,
+    // until it reaches a terminal or a vertex with surplus outflow, and surplus outflow is walked forwards. Every
+    // cancellation step removes one unit of flow from an edge, so this terminates.
+    void balance(uint32_t v) {
+      int x;
+      while ((x = excess(v)) != 0) {
+        int dir = (x > 0) ? 1 : -1;
+        if (extend(v, dir)) {
+          continue;
+        }
+
+        uint32_t u = v;
+        while (true) {
+          uint32_t next_edge = 0;
+          for (auto e : adjacency[u]) {
+            if (dir*flow_from(e, u) < 0) {
+              next_edge = e;
+              break;
+            }
+          }
+
+          uint32_t w = other(next_edge, u);
+          int excess_before = excess(w);
+          push(next_edge, u, dir);
+
+          if (side[w] != NONE || dir*excess_before < 0) {
+            break;
+          }
+
+          u = w;
+        }
+      }
+    }
+
+    // Drains a unit of surplus inflow at v into B (dir = 1), or supplies a unit of surplus outflow at v from A
+    // (dir = -1), along a shortest residual path. Returns false if there is no such path.
+    bool extend(uint32_t v, int dir) {
+      uint8_t target = (dir > 0) ? SINK : SOURCE;
+
+      uint32_t n = num_vertices();
+      std::vector<uint32_t> parent_edge(n, std::numeric_limits<uint32_t>::max());
+      std::vector<uint8_t> visited(n, 0);
+      std::vector<uint32_t> queue = {v};
+      visited[v] = 1;
+
+      for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t u = queue[head];
+        for (auto e : adjacency[u]) {
+          uint32_t w = other(e, u);
+          if (visited[w] || dir*flow_from(e, u) >= 1) {
+            continue;
+          }
+
+          visited[w] = 1;
+          parent_edge[w] = e;
+          if (side[w] == target) {
+            while (w != v) {
+              uint32_t pe = parent_edge[w];
+              uint32_t p = other(pe, w);
+              push(pe, p, dir);
+              w = p;
+            }
+
+            return true;
+          }
+
+          queue.push_back(w);
+        }
+      }
+
+      return false;
+    }
+
+    // Pushes one unit of flow along a shortest residual path from A to B, if any
+    bool augment() {
+      uint32_t n = num_vertices();
+      std::vector<uint32_t> parent_edge(n, std::numeric_limits<uint32_t>::max());
+      std::vector<uint8_t> visited(n, 0);
+      std::vector<uint32_t> queue;
+      for (uint32_t v = 0; v < n; v++) {
+        if (side[v] == SOURCE) {
+          visited[v] = 1;
+          queue.push_back(v);
+        }
+      }
+
+      for (size_t head = 0; head < queue.size(); head++) {
+        uint32_t u = queue[head];
+        for (auto e : adjacency[u]) {
+          uint32_t w = other(e, u);
+          if (visited[w] || flow_from(e, u) >= 1) {
+            continue;
+          }
+
+          visited[w] = 1;
+          parent_edge[w] = e;
+          if (side[w] == SINK) {
+            while (side[w] != SOURCE) {
+              uint32_t pe = parent_edge[w];
+              uint32_t p = other(pe, w);
+              push(pe, p, 1);
+              w = p;
+            }
+
+            return true;
+          }
+
+          queue.push_back(w);
+        }
+      }
+
+      return false;
+    }
+};
@@ -1,5 +1,7 @@
 #include "MinCutSimulator.h"
 
+#define DEFAULT_MAX_DEPTH 0
+
 using namespace dataframe;
 using namespace dataframe::utils;
 
@@ -9,11 +11,8 @@ double GraphEntropyState::entanglement(const QubitSupport &support, uint32_t ind
 		throw std::invalid_argument("Number of sites must be even in MinCutSimulator.");
 	}
 
-	uint32_t num_vertices = state.num_vertices;
-	uint32_t system_size = 2*state.num_vertices;
-
-	uint32_t tsteps = num_vertices/(system_size/2) - 1;
-	uint32_t d = tsteps*system_size/2;
+	// First vertex of the last row
+	uint32_t d = network.num_vertices() - width;
 
 	std::vector<uint32_t> subsystem_a;
 	for (auto q : sites) {
@@ -24,13 +23,13 @@ double GraphEntropyState::entanglement(const QubitSupport &support, uint32_t ind
 	uint32_t q2 = subsystem_a.back();
 
 	std::vector<uint32_t> subsystem_b;
-	for (uint32_t i = d; i < d + system_size/2; i++) {
+	for (uint32_t i = d; i < d + width; i++) {
 		if ((i < q1) || (i > q2)) {
 			subsystem_b.push_back(i);
 		}
 	}
 
-	return static_cast<double>(state.max_flow(subsystem_a, subsystem_b));
+	return static_cast<double>(network.min_cut(subsystem_a, subsystem_b));
 }
 
 
@@ -38,19 +37,35 @@ MinCutSimulator::MinCutSimulator(ExperimentParams &params, uint32_t) : Simulator
 	system_size = get<int>(params, "system_size");
 	mzr_prob = get<double>(params, "mzr_prob");
 
+	// Number of most recent rows kept in the graph; 0 keeps the whole circuit
+	max_depth = get<int>(params, "max_depth", DEFAULT_MAX_DEPTH);
+
+	offset = false;
+
 	state = std::make_shared<GraphEntropyState>(system_size/2);
 }
 
 std::string MinCutSimulator::to_string() const {
-	return state->state.to_string();
+	return state->network.to_string();
+}
+
+// Discards the rows older than depth. Cuts which would have continued below the oldest kept row instead leave through
+// it at no cost, so cut values are capped by those of the window; they are exact whenever the minimal cut of the full
+// circuit stays within the last depth rows.
+void MinCutSimulator::truncate(uint32_t depth) {
+	uint32_t width = system_size/2;
+	uint32_t num_rows = state->network.num_vertices()/width;
+	if (num_rows > depth) {
+		state->network.remove_front((num_rows - depth)*width);
+	}
 }
 
 void MinCutSimulator::timesteps(uint32_t num_steps) {
 	for (uint32_t t = 0; t < num_steps; t++) {
-		uint32_t num_vertices = state->state.num_vertices;
+		uint32_t num_vertices = state->network.num_vertices();
 		uint32_t num_new_vertices = system_size/2;
 		for (uint32_t i = 0; i < num_new_vertices; i++) {
-			state->state.add_vertex();
+			state->network.add_vertex();
 		}
 
 		for (uint32_t i = 0; i < num_new_vertices; i++) {
@@ -63,13 +78,18 @@ void MinCutSimulator::timesteps(uint32_t num_steps) {
 			uint32_t v3 = (row - 1)*num_new_vertices + next_col;
 
 			if (randf() < 1. - mzr_prob) {
-				state->state.add_edge(v1, v2);
+				state->network.add_edge(v1, v2);
 			}
 			if (randf() < 1. - mzr_prob) {
-				state->state.add_edge(v1, v3);
+				state->network.add_edge(v1, v3);
 			}
 		}
 
+		// Compact only once the window has doubled, so that removal is amortized over many steps
+		if (max_depth && state->network.num_vertices() > 2*max_depth*num_new_vertices) {
+			truncate(max_depth);
+		}
+
 	}
 	
 	if (num_steps % 2 == 1) {
@@ -79,6 +99,10 @@ void MinCutSimulator::timesteps(uint32_t num_steps) {
 
 
 SampleMap MinCutSimulator::take_samples() {
+	if (max_depth) {
+		truncate(max_depth);
+	}
+
 	SampleMap samples;
 	sampler.add_samples(samples, state);
 	return samples;
@@ -1,17 +1,19 @@
 #pragma once
 
-#include <Graph.hpp>
 #include <Simulator.hpp>
 #include <Samplers.h>
 
+#include "IncrementalMinCut.hpp"
+
 class GraphEntropyState : public EntanglementEntropyState {
 	public:
-		Graph<int, int> state;
+		// Vertices are added in rows of width; the subsystems of a cut lie in the last row
+		IncrementalMinCut network;
+		uint32_t width = 0;
+
 		virtual double entanglement(const QubitSupport& support, uint32_t index) override;
 		GraphEntropyState()=default;
-		GraphEntropyState(uint32_t num_nodes) {
-			state = Graph<int, int>(num_nodes);
-		}
+		GraphEntropyState(uint32_t num_nodes) : network(num_nodes), width(num_nodes) {}
 };
 
 class MinCutSimulator : public Simulator {
@@ -20,11 +22,14 @@ class MinCutSimulator : public Simulator {
 
 		uint32_t system_size;
 		double mzr_prob;
+		uint32_t max_depth;
 
 		bool offset;
 
 		EntropySampler sampler;
 
+		void truncate(uint32_t depth);
+
 	public:
 		MinCutSimulator(dataframe::ExperimentParams &params, uint32_t);
 
@@ -1,12 +1,17 @@
 #include "NetworkCliffordSimulator.h"
 
+#include <PrefixEntropy.hpp>
+
+#include <thread>
+
 #define DEFAULT_NUM_PARTITIONS 10
 
 using namespace dataframe;
 using namespace dataframe::utils;
 
-NetworkCliffordSimulator::NetworkCliffordSimulator(ExperimentParams &params, uint32_t) : Simulator(params), sampler(params) {
+NetworkCliffordSimulator::NetworkCliffordSimulator(ExperimentParams &params, uint32_t num_threads) : Simulator(params), sampler(params) {
 	system_size = get<int>(params, "system_size");
+	this->num_threads = std::max(num_threads, 1u);
 
 	p = get<double>(params, "p");
 	mzr_prob = get<double>(params, "mzr_prob");
@@ -17,17 +22,46 @@ NetworkCliffordSimulator::NetworkCliffordSimulator(ExperimentParams &params, uin
 
 	state = std::make_shared<QuantumCHPState>(system_size);
 	network = UndirectedGraph<int>::scale_free_graph(system_size, alpha);
+
+	// The network is fixed after construction, so freeze its adjacency into CSR arrays
+	edge_offsets = std::vector<uint32_t>(system_size + 1, 0);
+	for (uint32_t i = 0; i < system_size; i++) {
+		for (auto const &j : network.edges_of(i)) {
+			edge_targets.push_back(j);
+		}
+		edge_offsets[i + 1] = edge_targets.size();
+	}
+
+	log_skip = std::log1p(-p);
+}
+
+// Number of edges passed over before the next one selected with probability p
+uint32_t NetworkCliffordSimulator::edge_skip() const {
+	if (p >= 1.0) {
+		return 0;
+	}
+
+	double skip = std::floor(std::log(1.0 - randf())/log_skip);
+	if (skip >= static_cast<double>(edge_targets.size())) {
+		return edge_targets.size();
+	}
+
+	return static_cast<uint32_t>(skip);
 }
 
 void NetworkCliffordSimulator::timesteps(uint32_t num_steps) {
 	for (uint32_t k = 0; k < num_steps; k++) {
 		for (uint32_t i = 0; i < system_size; i++) {
 			uint32_t q = rand() % system_size;
-			for (auto const &j : network.edges_of(q)) {
-				if (randf() < p) {
-					std::vector<uint32_t> qubits{q, j};
-					state->random_clifford(qubits);
-				}
+			if (p <= 0.0) {
+				continue;
+			}
+
+			// Visit only the selected edges of q, skipping a geometric number of edges between them
+			uint32_t end = edge_offsets[q + 1];
+			for (uint32_t e = edge_offsets[q] + edge_skip(); e < end; e += 1 + edge_skip()) {
+				std::vector<uint32_t> qubits{q, edge_targets[e]};
+				state->random_clifford(qubits);
 			}
 		}
 	}
@@ -50,22 +84,50 @@ void NetworkCliffordSimulator::add_degree_distribution(SampleMap& samples) const
 	}
 }
 
+// Entropies of a batch of subsystems. The stabilizer rows are packed once and shared read-only between the threads,
+// each of which takes the masked GF(2) rank of its own subsystems. Stabilizer entropies do not depend on the Renyi
+// index.
+std::vector<double> NetworkCliffordSimulator::batch_entanglement(const std::vector<std::vector<uint32_t>>& subsystems) const {
+	const StabilizerRows stabilizers(*state);
+
+	std::vector<double> s(subsystems.size());
+	uint32_t num_chunks = std::max(1u, std::min<uint32_t>(num_threads, subsystems.size()));
+	auto compute = [&stabilizers, &subsystems, &s, num_chunks](uint32_t c) {
+		for (size_t i = c; i < subsystems.size(); i += num_chunks) {
+			s[i] = stabilizers.entropy(subsystems[i]);
+		}
+	};
+
+	if (num_chunks == 1) {
+		compute(0);
+		return s;
+	}
+
+	std::vector<std::thread> threads;
+	for (uint32_t c = 0; c < num_chunks; c++) {
+		threads.emplace_back(compute, c);
+	}
+
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	return s;
+}
+
 void NetworkCliffordSimulator::add_spatially_averaged_entropy(SampleMap& samples) {
 	std::vector<uint32_t> all_qubits(system_size);
 	std::iota(all_qubits.begin(), all_qubits.end(), 0);
 
-	uint32_t num_partitions = 10;
-  std::vector<double> s(num_partitions);
-
+	// Draw every partition up front, then evaluate them as one batch
+	std::vector<std::vector<uint32_t>> partitions(num_partitions);
 	thread_local std::mt19937 gen(rand());
 	for (uint32_t i = 0; i < num_partitions; i++) {
 		std::shuffle(all_qubits.begin(), all_qubits.end(), gen);
-
-		std::vector<uint32_t> qubits(all_qubits.begin(), all_qubits.begin() + system_size/2);
-    s[i] = state->entanglement(qubits, 2);
+		partitions[i] = std::vector<uint32_t>(all_qubits.begin(), all_qubits.begin() + system_size/2);
 	}
 
-  emplace(samples, "entropy", s);
+  emplace(samples, "entropy", batch_entanglement(partitions));
 }
 
 SampleMap NetworkCliffordSimulator::take_samples() {
@@ -15,14 +15,23 @@ class NetworkCliffordSimulator : public Simulator {
 		double alpha;
 
 		uint32_t num_partitions;
+		uint32_t num_threads;
 
 		std::shared_ptr<QuantumCHPState> state;
 		UndirectedGraph<int> network;
 
+		// CSR adjacency of network: the neighbors of i are edge_targets[edge_offsets[i]..edge_offsets[i + 1])
+		std::vector<uint32_t> edge_offsets;
+		std::vector<uint32_t> edge_targets;
+		double log_skip;
+
+		uint32_t edge_skip() const;
+
 		EntropySampler sampler;
 
 
 		void add_degree_distribution(dataframe::SampleMap& samples) const;
+		std::vector<double> batch_entanglement(const std::vector<std::vector<uint32_t>>& subsystems) const;
 		void add_spatially_averaged_entropy(dataframe::SampleMap& samples);
 
 	public:
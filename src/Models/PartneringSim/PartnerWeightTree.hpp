@@ -0,0 +1,136 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <algorithm>
+
+// Fenwick trees over the partners of every drawing node, for sampling partner j of node i with weight
+//   w_ij = a_ij*(1 - exp(-(now - t_ij)/T)),
+// where a_ij is the affinity and t_ij the time of last contact. Writing w_ij = a_ij - exp(-(now - t0)/T)*b_ij with
+// b_ij = a_ij*exp((t_ij - t0)/T), the time dependence is a single global factor, so every weight relaxes lazily:
+// advancing time costs nothing, and a contact or the removal of a drawn partner updates one entry of one tree in
+// O(log N). Since the trees are linear, the reference time t0 is rebased by rescaling the b trees once the factor would
+// overflow.
+class PartnerWeightTree {
+  public:
+    PartnerWeightTree()=default;
+
+    PartnerWeightTree(uint32_t num_nodes, double relaxation_time)
+      : num_nodes(num_nodes), relaxation_time(relaxation_time), t0(0), decay(1.0),
+        affinity_sums(num_nodes*num_nodes, 0.0), relaxed_sums(num_nodes*num_nodes, 0.0) {
+      if (relaxation_time <= 0.0) {
+        throw std::invalid_argument("Relaxation time must be positive.");
+      }
+
+      top_bit = 1;
+      while (2*top_bit <= num_nodes) {
+        top_bit *= 2;
+      }
+    }
+
+    // Sets the affinities and contact times of every pair at once; O(N^2)
+    template <typename A, typename C>
+    void build(A&& affinity, C&& contact_time) {
+      for (uint32_t i = 0; i < num_nodes; i++) {
+        for (uint32_t j = 0; j < num_nodes; j++) {
+          double a = affinity(i, j);
+          affinity_sums[index(i, j + 1)] = a;
+          relaxed_sums[index(i, j + 1)] = a*relaxation(contact_time(i, j));
+        }
+
+        for (uint32_t k = 1; k <= num_nodes; k++) {
+          uint32_t parent = k + (k & -k);
+          if (parent <= num_nodes) {
+            affinity_sums[index(i, parent)] += affinity_sums[index(i, k)];
+            relaxed_sums[index(i, parent)] += relaxed_sums[index(i, k)];
+          }
+        }
+      }
+    }
+
+    // Moves the last contact of (i, j), which has affinity a, from t_old to t_new
+    void contact(uint32_t i, uint32_t j, double a, uint64_t t_old, uint64_t t_new) {
+      double delta = a*(relaxation(t_new) - relaxation(t_old));
+      for (uint32_t k = j + 1; k <= num_nodes; k += k & -k) {
+        relaxed_sums[index(i, k)] += delta;
+      }
+    }
+
+    // Removes (active = false) or restores the weight of partner j of node i, which has affinity a and was last contacted
+    // at t
+    void set_active(uint32_t i, uint32_t j, double a, uint64_t t, bool active) {
+      double sign = active ? 1.0 : -1.0;
+      double da = sign*a;
+      double db = sign*a*relaxation(t);
+      for (uint32_t k = j + 1; k <= num_nodes; k += k & -k) {
+        affinity_sums[index(i, k)] += da;
+        relaxed_sums[index(i, k)] += db;
+      }
+    }
+
+    void advance(uint64_t now) {
+      double x = double(now - t0)/relaxation_time;
+      if (x > MAX_EXPONENT) {
+        double scale = std::exp(-x);
+        for (double& b : relaxed_sums) {
+          b *= scale;
+        }
+        t0 = now;
+        x = 0.0;
+      }
+
+      decay = std::exp(-x);
+    }
+
+    double total(uint32_t i) const {
+      double a = 0.0;
+      double b = 0.0;
+      for (uint32_t k = num_nodes; k > 0; k -= k & -k) {
+        a += affinity_sums[index(i, k)];
+        b += relaxed_sums[index(i, k)];
+      }
+
+      return a - decay*b;
+    }
+
+    // Partner j of node i at which the cumulative weight first exceeds r, for r in [0, total(i))
+    uint32_t sample(uint32_t i, double r) const {
+      uint32_t pos = 0;
+      for (uint32_t mask = top_bit; mask > 0; mask >>= 1) {
+        uint32_t next = pos + mask;
+        if (next <= num_nodes) {
+          double w = affinity_sums[index(i, next)] - decay*relaxed_sums[index(i, next)];
+          if (r >= w) {
+            r -= w;
+            pos = next;
+          }
+        }
+      }
+
+      // Rounding can carry pos past the last partner
+      return std::min(pos, num_nodes - 1);
+    }
+
+  private:
+    static constexpr double MAX_EXPONENT = 32.0;
+
+    uint32_t num_nodes;
+    uint32_t top_bit;
+    double relaxation_time;
+    uint64_t t0;
+    double decay;
+
+    // Row-major Fenwick trees, one row per drawing node; entry k of row i lives at i*N + k - 1
+    std::vector<double> affinity_sums;
+    std::vector<double> relaxed_sums;
+
+    inline size_t index(uint32_t i, uint32_t k) const {
+      return static_cast<size_t>(i)*num_nodes + k - 1;
+    }
+
+    inline double relaxation(uint64_t t) const {
+      return std::exp((double(t) - double(t0))/relaxation_time);
+    }
+};
@@ -19,41 +19,103 @@ PartneringSimulator::PartneringSimulator(ExperimentParams &params, uint32_t) : S
 	sample_global_properties = get<int>(params, "sample_global_properties", true);
 	sample_local_properties = get<int>(params, "sample_local_properties", false);
 	sample_affinity = get<int>(params, "sample_affinity", false);
+	sample_affinity_matrix = get<int>(params, "sample_affinity_matrix", false);
 	sample_counts = get<int>(params, "sample_counts", false);
 
 	counts = std::vector<std::vector<uint32_t>>(num_nodes, std::vector<uint32_t>(num_nodes, 0));
 
 
 	partner_graph = UndirectedGraph<int>(2*num_nodes);
-	affinity_graph = UndirectedGraph<int, int>(2*num_nodes);
-	augmented_graph = UndirectedGraph<int, int>(2*num_nodes);
+	affinities = std::vector<float>(num_nodes*num_nodes, 0.0);
 
 	for (uint32_t i = 0; i < num_nodes; i++) {
-		for (uint32_t j = num_nodes; j < 2*num_nodes; j++) {
+		for (uint32_t j = 0; j < num_nodes; j++) {
 			double affinity = 0.0;
 			if (affinity_type == POWER_LAW) {
 				affinity = power_law(1.0, 2.0, -5.0, randf()) - 1.0;
 			} else if (affinity_type == DELTA) {
-				affinity = (j == i + num_nodes) ? 1.0 : 1.0/num_nodes;
+				affinity = (j == i) ? 1.0 : 1.0/num_nodes;
 			} else if (affinity_type == PROXIMITY) {
-				uint32_t d = std::abs(int(i - (j - num_nodes)));
+				uint32_t d = std::abs(int(i - j));
 				if (d > num_nodes/2) {
 					d = num_nodes - d;
 				}
 				affinity = double(d)/num_nodes;
 			}
 
-			affinity_graph.add_edge(i, j, int(affinity*INT_MAX));
+			affinities[static_cast<size_t>(i)*num_nodes + j] = affinity;
+		}
+	}
+
+	time = 0;
+	contact_times = std::vector<uint64_t>(num_nodes*num_nodes, 0);
+	drawn = std::vector<bool>(num_nodes, false);
+	partners = std::vector<uint32_t>(num_nodes);
+	fallback_weights = std::vector<double>(num_nodes);
+	partner_weights = PartnerWeightTree(num_nodes, num_nodes*relaxation_time);
+	partner_weights.build(
+		[this](uint32_t i, uint32_t j) { return affinity(i, j); },
+		[this](uint32_t i, uint32_t j) { return last_contact(i, j); }
+	);
+}
+
+// Returns the index (relative to num_nodes) of the partner drawn by node i among the partners not yet drawn this step.
+// Drawn partners have been removed from the weight tree of node i, so a proposal from the tree is only rejected when
+// rounding in the tree sums lands on a drawn or vanishing partner; in that case, fall back to an exact pass over the
+// undrawn partners.
+uint32_t PartneringSimulator::draw_partner(uint32_t i) {
+	double total = partner_weights.total(i);
+	if (total > 0.0) {
+		uint32_t j = partner_weights.sample(i, randf()*total);
+		if (!drawn[j] && partner_weight(i, j) > 0.0) {
+			return j;
+		}
+	}
+
+	// Exact weights of the undrawn partners, evaluated over the contiguous rows of node i
+	const float* affinity_row = &affinities[static_cast<size_t>(i)*num_nodes];
+	const uint64_t* contact_row = &contact_times[static_cast<size_t>(i)*num_nodes];
+	double rate = 1.0/double(num_nodes*relaxation_time);
+
+	double undrawn_total = 0.0;
+	uint32_t num_undrawn = 0;
+	for (uint32_t j = 0; j < num_nodes; j++) {
+		double undrawn = drawn[j] ? 0.0 : 1.0;
+		fallback_weights[j] = undrawn*affinity_row[j]*(1.0 - std::exp(-double(time - contact_row[j])*rate));
+		undrawn_total += fallback_weights[j];
+		num_undrawn += !drawn[j];
+	}
+
+	// If every remaining partner has vanishing weight, choose uniformly among them
+	if (!(undrawn_total > 0.0)) {
+		uint32_t k = randi() % num_undrawn;
+		for (uint32_t j = 0; j < num_nodes; j++) {
+			if (!drawn[j] && k-- == 0) {
+				return j;
+			}
+		}
+	}
 
-			augmented_graph.add_edge(i, j, 0);
+	double r = randf()*undrawn_total;
+	uint32_t last = 0;
+	for (uint32_t j = 0; j < num_nodes; j++) {
+		if (fallback_weights[j] > 0.0) {
+			if (r < fallback_weights[j]) {
+				return j;
+			}
+			r -= fallback_weights[j];
+			last = j;
 		}
 	}
+
+	return last;
 }
 
 void PartneringSimulator::timesteps(uint32_t num_steps) {
 	for (uint32_t k = 0; k < num_steps; k++) {
 		// Keep track of drawn nodes
-		std::vector<uint32_t> drawn;
+		std::fill(drawn.begin(), drawn.end(), false);
+		partner_weights.advance(time);
 
 		// Drawing nodes choose partner in a random order
 		std::vector<uint> first(num_nodes);
@@ -62,51 +124,49 @@ void PartneringSimulator::timesteps(uint32_t num_steps) {
 
 		for (uint32_t i = 0; i < num_nodes; i++) {
 			uint32_t idx1 = first[i];
-			std::vector<double> weights;
-			for (uint32_t j = num_nodes; j < 2*num_nodes; j++) {
-				double weight;
-				if (std::count(drawn.begin(), drawn.end(), j)) {
-					weight = 0.;
-				} else {
-					weight = affinity(idx1, j)*(1.0 - std::exp(-double(last_contact(idx1, j))/double(num_nodes*relaxation_time)));
-				}
-
-				weights.push_back(weight);
+			uint32_t j = draw_partner(idx1);
+			uint32_t idx2 = j + num_nodes;
+			drawn[j] = true;
+			partners[i] = j;
+
+			// Partner j is no longer available to the nodes which have yet to draw
+			for (uint32_t r = i + 1; r < num_nodes; r++) {
+				partner_weights.set_active(first[r], j, affinity(first[r], j), last_contact(first[r], j), false);
 			}
 
-			std::discrete_distribution<uint32_t> dist(weights.begin(), weights.end());
-			uint32_t idx2 = dist(rng) + num_nodes;
-			drawn.push_back(idx2);
-
 			partner_graph.add_edge(idx1, idx2);
-			augmented_graph.set_edge_weight(idx1, idx2, 0);
-			augmented_graph.set_edge_weight(idx2, idx1, 0);
+			partner_weights.contact(idx1, j, affinity(idx1, j), last_contact(idx1, j), time);
+			contact_times[static_cast<size_t>(idx1)*num_nodes + j] = time;
 			if (start_sampling) {
 				counts[idx1][idx2 - num_nodes]++;
 			}
 		}
 
-
-
-		// Reduce weights of augmented graph
+		// Restore the removed partners; none of these pairs made contact this step
 		for (uint32_t i = 0; i < num_nodes; i++) {
-			for (uint32_t j = num_nodes; j < 2*num_nodes; j++) {
-				uint32_t new_weight = augmented_graph.edge_weight(i, j) + 1;
-				augmented_graph.set_edge_weight(i, j, new_weight);
-				augmented_graph.set_edge_weight(j, i, new_weight);
+			uint32_t j = partners[i];
+			for (uint32_t r = i + 1; r < num_nodes; r++) {
+				partner_weights.set_active(first[r], j, affinity(first[r], j), last_contact(first[r], j), true);
 			}
 		}
+
+		time++;
 	}
 }
 
 void PartneringSimulator::add_affinity_samples(SampleMap& samples) const {
 	for (uint32_t i = 0; i < num_nodes; i++) {
-		for (uint32_t j = num_nodes; j < 2*num_nodes; j++) {
-      dataframe::utils::emplace(samples, fmt::format("affinity_{}_{}", i, j - num_nodes), affinity(i, j));
+		for (uint32_t j = 0; j < num_nodes; j++) {
+      dataframe::utils::emplace(samples, fmt::format("affinity_{}_{}", i, j), affinity(i, j));
 		}
 	}
 }
 
+void PartneringSimulator::add_affinity_matrix_samples(SampleMap& samples) const {
+	std::vector<double> matrix(affinities.begin(), affinities.end());
+	dataframe::utils::emplace(samples, "affinity", matrix);
+}
+
 void PartneringSimulator::add_global_properties_samples(SampleMap& samples) const {
   dataframe::utils::emplace(samples, "global_clustering_coefficient", partner_graph.global_clustering_coefficient());
 	dataframe::utils::emplace(samples, "percolation_probability", partner_graph.percolation_probability());
@@ -136,6 +196,10 @@ SampleMap PartneringSimulator::take_samples() {
 		add_affinity_samples(samples);
 	}
 
+	if (sample_affinity_matrix) {
+		add_affinity_matrix_samples(samples);
+	}
+
 	if (sample_global_properties) {
 		add_global_properties_samples(samples);
 	}
@@ -4,7 +4,7 @@
 #include <Graph.hpp>
 #include <Simulator.hpp>
 
-#include <climits>
+#include "PartnerWeightTree.hpp"
 
 static inline double power_law(double x0, double x1, double n, double r) {
 	return std::pow(((std::pow(x1, n + 1.0) - std::pow(x0, n + 1.0))*r + std::pow(x0, n + 1.0)), 1.0/(n + 1.0));
@@ -20,30 +20,56 @@ class PartneringSimulator : public Simulator {
 		bool sample_global_properties;
 		bool sample_local_properties;
 		bool sample_affinity;
+		bool sample_affinity_matrix;
 		bool sample_counts;
 
 		bool start_sampling = false;
 
+		uint64_t time;
+		PartnerWeightTree partner_weights;
+		std::vector<bool> drawn;
+
+		// Partner drawn by the i-th drawing node of the current step
+		std::vector<uint32_t> partners;
+
+		// Scratch weights for the exact pass in draw_partner
+		std::vector<double> fallback_weights;
+
+		// Affinity between drawing node i and node j + num_nodes, stored row-major
+		std::vector<float> affinities;
+
+		// Step at which drawing node i last partnered with node j + num_nodes, stored row-major. Ages are computed as
+		// time - last_contact, so advancing a step does not touch the pairs.
+		std::vector<uint64_t> contact_times;
+
+		double partner_weight(uint32_t i, uint32_t j) const {
+			return affinity(i, j)*(1.0 - std::exp(-double(age(i, j))/double(num_nodes*relaxation_time)));
+		}
+
+		uint32_t draw_partner(uint32_t i);
 
 		std::vector<std::vector<uint32_t>> counts;
 
 		double affinity(uint32_t i, uint32_t j) const {
-			return double(affinity_graph.edge_weight(i, j))/INT_MAX;
+			return affinities[static_cast<size_t>(i)*num_nodes + j];
+		}
+
+		uint64_t last_contact(uint32_t i, uint32_t j) const {
+			return contact_times[static_cast<size_t>(i)*num_nodes + j];
 		}
 
-		double last_contact(uint32_t i, uint32_t j) const {
-			return augmented_graph.edge_weight(i, j);
+		uint64_t age(uint32_t i, uint32_t j) const {
+			return time - last_contact(i, j);
 		}
 
 		void add_affinity_samples(dataframe::SampleMap& samples) const;
+		void add_affinity_matrix_samples(dataframe::SampleMap& samples) const;
 		void add_global_properties_samples(dataframe::SampleMap& samples) const;
 		void add_local_properties_samples(dataframe::SampleMap& samples) const;
 		void add_counts_samples(dataframe::SampleMap& samples) const;
 
 	public:
 		UndirectedGraph<int> partner_graph;
-		UndirectedGraph<int, int> affinity_graph;
-		UndirectedGraph<int, int> augmented_graph;
 
 		PartneringSimulator(dataframe::ExperimentParams &params, uint32_t);
 
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Simulator.hpp>
+#include <Samplers.h>
+
+#include <glaze/glaze.hpp>
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+// Fixed-memory, log-binned histogram of avalanche sizes. A size s >= 1 is counted in bin floor(bins_per_octave*log2(s)),
+// so that bin b covers [2^(b/bins_per_octave), 2^((b+1)/bins_per_octave)); sizes beyond max_size fall in the last bin.
+// Counts are emitted as a single array sample and reset, so that they can be summed across samples and runs without
+// keeping every event; counts not yet emitted are carried through checkpoints by the simulator's serialization.
+class AvalancheHistogram {
+  public:
+    uint32_t bins_per_octave = 0;
+    std::vector<double> counts;
+
+    AvalancheHistogram()=default;
+
+    AvalancheHistogram(uint32_t max_size, uint32_t bins_per_octave) : bins_per_octave(bins_per_octave) {
+      counts = std::vector<double>(bin(std::max(max_size, 1u)) + 1, 0.0);
+    }
+
+    size_t bin(uint32_t s) const {
+      return static_cast<size_t>(bins_per_octave*std::log2(s));
+    }
+
+    void record(uint32_t s) {
+      if (s == 0) {
+        return;
+      }
+
+      counts[std::min(bin(s), counts.size() - 1)]++;
+    }
+
+    void add_samples(dataframe::SampleMap& samples) {
+      dataframe::utils::emplace(samples, "avalanche_histogram", counts);
+      std::fill(counts.begin(), counts.end(), 0.0);
+    }
+
+    struct glaze {
+      static constexpr auto value = glz::object(
+          "bins_per_octave", &AvalancheHistogram::bins_per_octave,
+          "counts", &AvalancheHistogram::counts
+      );
+    };
+};
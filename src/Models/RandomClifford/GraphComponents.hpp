@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <numeric>
+#include <algorithm>
+
+// Connected components of a graph state's adjacency, kept in a union-find forest together with the size of the largest
+// component and the number of components, so that component statistics are O(1) queries. Edge insertions are merged
+// incrementally; any other change to the graph (deleted edges, local complementation, measurements, general Clifford
+// gates) invalidates the index, which is then rebuilt from the adjacency in a single pass on the next query.
+class GraphComponents {
+  public:
+    GraphComponents()=default;
+
+    GraphComponents(uint32_t num_vertices) : num_vertices(num_vertices), valid(false) {}
+
+    void invalidate() {
+      valid = false;
+    }
+
+    // Records the insertion of edge (i, j)
+    void add_edge(uint32_t i, uint32_t j) {
+      if (valid) {
+        merge(i, j);
+      }
+    }
+
+    template <typename G>
+    uint32_t max_component_size(const G& graph) {
+      update(graph);
+      return max_size;
+    }
+
+    template <typename G>
+    double average_component_size(const G& graph) {
+      update(graph);
+      return double(num_vertices)/num_components;
+    }
+
+  private:
+    uint32_t num_vertices;
+    bool valid;
+
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> sizes;
+    uint32_t max_size;
+    uint32_t num_components;
+
+    template <typename G>
+    void update(const G& graph) {
+      if (valid) {
+        return;
+      }
+
+      parent.resize(num_vertices);
+      std::iota(parent.begin(), parent.end(), 0);
+      sizes.assign(num_vertices, 1);
+      max_size = std::min(num_vertices, 1u);
+      num_components = num_vertices;
+
+      for (uint32_t i = 0; i < num_vertices; i++) {
+        for (auto const j : graph.neighbors(i)) {
+          if (uint32_t(j) > i) {
+            merge(i, j);
+          }
+        }
+      }
+
+      valid = true;
+    }
+
+    uint32_t find(uint32_t i) {
+      while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+      }
+
+      return i;
+    }
+
+    void merge(uint32_t i, uint32_t j) {
+      uint32_t ri = find(i);
+      uint32_t rj = find(j);
+      if (ri == rj) {
+        return;
+      }
+
+      if (sizes[ri] < sizes[rj]) {
+        std::swap(ri, rj);
+      }
+
+      parent[rj] = ri;
+      sizes[ri] += sizes[rj];
+      max_size = std::max(max_size, sizes[ri]);
+      num_components--;
+    }
+};
@@ -4,6 +4,8 @@
 #include <CliffordState.h>
 #include <Samplers.h>
 
+#include <AvalancheHistogram.hpp>
+
 #include <Display.h>
 
 #include <glaze/glaze.hpp>
@@ -14,6 +16,8 @@
 
 #define RC_DEFAULT_PBC true
 
+#define RC_DEFAULT_BINS_PER_OCTAVE 4
+
 #define RC_BRICKWORK 0
 #define RC_RANDOM_LOCAL 1
 #define RC_RANDOM_NONLOCAL 2
@@ -72,6 +76,8 @@ class RandomCliffordSimulator : public Simulator {
 
 		bool sample_sparsity;
 		bool sample_avalanche_sizes;
+		bool avalanche_histogram;
+		AvalancheHistogram histogram;
 
 		EntropySampler entropy_sampler;
 		InterfaceSampler interface_sampler;
@@ -153,7 +159,11 @@ class RandomCliffordSimulator : public Simulator {
           s += std::abs(surface1[i] - surface2[i]);
         }
 
-        interface_sampler.record_size(s);
+        if (avalanche_histogram) {
+          histogram.record(s);
+        } else {
+          interface_sampler.record_size(s);
+        }
       } else {
         state->mzr(q);
       }
@@ -176,6 +186,10 @@ class RandomCliffordSimulator : public Simulator {
       simulator_type = dataframe::utils::get<std::string>(params, "simulator_type", RC_DEFAULT_CLIFFORD_SIMULATOR);
 
       sample_avalanche_sizes = dataframe::utils::get<int>(params, "sample_avalanche_sizes", false);
+      avalanche_histogram = dataframe::utils::get<int>(params, "avalanche_histogram", false);
+      if (avalanche_histogram) {
+        histogram = AvalancheHistogram(system_size*system_size, dataframe::utils::get<int>(params, "avalanche_bins_per_octave", RC_DEFAULT_BINS_PER_OCTAVE));
+      }
 
       offset = false;
       pbc = dataframe::utils::get<int>(params, "pbc", RC_DEFAULT_PBC);
@@ -230,6 +244,9 @@ class RandomCliffordSimulator : public Simulator {
 
       std::vector<int> surface = state->get_entanglement<int>(2);
       interface_sampler.add_samples(samples, surface);
+      if (avalanche_histogram) {
+        histogram.add_samples(samples);
+      }
 
       if (sample_sparsity) {
         dataframe::utils::emplace(samples, "sparsity", state->sparsity());
@@ -244,7 +261,8 @@ class RandomCliffordSimulator : public Simulator {
 
     struct glaze {
       static constexpr auto value = glz::object(
-          "state", &RandomCliffordSimulator::state
+          "state", &RandomCliffordSimulator::state,
+          "histogram", &RandomCliffordSimulator::histogram
       );
     };
 };
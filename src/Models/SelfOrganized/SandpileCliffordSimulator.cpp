@@ -1,5 +1,6 @@
 #include "SandpileCliffordSimulator.h"
 #include "RandomCliffordSimulator.hpp"
+#include "SurfaceShapes.hpp"
 
 #define DEFAULT_BOUNDARY_CONDITIONS "pbc"
 #define DEFAULT_FEEDBACK_MODE 22
@@ -7,6 +8,8 @@
 #define DEFAULT_MZR_MODE 1
 
 #define DEFAULT_SAMPLE_AVALANCHES false
+#define DEFAULT_AVALANCHE_HISTOGRAM false
+#define DEFAULT_BINS_PER_OCTAVE 4
 
 #define SUBSTRATE 0
 #define PYRAMID 1 
@@ -28,6 +31,10 @@ SandpileCliffordSimulator::SandpileCliffordSimulator(ExperimentParams &params, u
   mzr_mode = get<int>(params, "mzr_mode", DEFAULT_MZR_MODE);
 
   sample_avalanche_sizes = get<int>(params, "sample_avalanche_sizes", false);
+  avalanche_histogram = get<int>(params, "avalanche_histogram", DEFAULT_AVALANCHE_HISTOGRAM);
+  if (avalanche_histogram) {
+    histogram = AvalancheHistogram(system_size*system_size, get<int>(params, "avalanche_bins_per_octave", DEFAULT_BINS_PER_OCTAVE));
+  }
   start_sampling = false;
 
   sample_reduced_surface = get<int>(params, "sample_reduced_surface", false);
@@ -35,44 +42,7 @@ SandpileCliffordSimulator::SandpileCliffordSimulator(ExperimentParams &params, u
   initial_state = get<int>(params, "initial_state", SUBSTRATE);
   scrambling_steps = get<int>(params, "scrambling_steps", system_size);
 
-  // ------------------ TETRONIMOS -------------------
-  // |  (1)  |  (2)  |  (3)  |  (4)  |  (5)  |  (6)  |
-  // |       |       |       |       |       |     o |
-  // |	   |   o   | o   o |     o |   o o |   o o |
-  // | o o o | o o o | o o o | o o o | o o o | o o o |
-  if (feedback_mode == 0)       feedback_strategy = std::vector<uint32_t>{1};
-  else if (feedback_mode == 1)  feedback_strategy = std::vector<uint32_t>{1, 2};
-  else if (feedback_mode == 2)  feedback_strategy = std::vector<uint32_t>{1, 3};
-  else if (feedback_mode == 3)  feedback_strategy = std::vector<uint32_t>{1, 4};
-  else if (feedback_mode == 4)  feedback_strategy = std::vector<uint32_t>{1, 5};
-  else if (feedback_mode == 5)  feedback_strategy = std::vector<uint32_t>{1, 6};
-  else if (feedback_mode == 6)  feedback_strategy = std::vector<uint32_t>{1, 2, 3};
-  else if (feedback_mode == 7)  feedback_strategy = std::vector<uint32_t>{1, 2, 4};
-  else if (feedback_mode == 8)  feedback_strategy = std::vector<uint32_t>{1, 2, 5};
-  else if (feedback_mode == 9)  feedback_strategy = std::vector<uint32_t>{1, 2, 6};
-  else if (feedback_mode == 10) feedback_strategy = std::vector<uint32_t>{1, 3, 4};
-  else if (feedback_mode == 11) feedback_strategy = std::vector<uint32_t>{1, 3, 5};
-  else if (feedback_mode == 12) feedback_strategy = std::vector<uint32_t>{1, 3, 6};
-  else if (feedback_mode == 13) feedback_strategy = std::vector<uint32_t>{1, 4, 5};
-  else if (feedback_mode == 14) feedback_strategy = std::vector<uint32_t>{1, 4, 6};
-  else if (feedback_mode == 15) feedback_strategy = std::vector<uint32_t>{1, 5, 6};
-  else if (feedback_mode == 16) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4};
-  else if (feedback_mode == 17) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 5};
-  else if (feedback_mode == 18) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 6};
-  else if (feedback_mode == 19) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 5};
-  else if (feedback_mode == 20) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 6};
-  else if (feedback_mode == 21) feedback_strategy = std::vector<uint32_t>{1, 2, 5, 6};
-  else if (feedback_mode == 22) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 5};
-  else if (feedback_mode == 23) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 6};
-  else if (feedback_mode == 24) feedback_strategy = std::vector<uint32_t>{1, 3, 5, 6};
-  else if (feedback_mode == 25) feedback_strategy = std::vector<uint32_t>{1, 4, 5, 6};
-  else if (feedback_mode == 26) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4, 5};
-  else if (feedback_mode == 27) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4, 6};
-  else if (feedback_mode == 28) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 5, 6};
-  else if (feedback_mode == 29) feedback_strategy = std::vector<uint32_t>{1, 2, 4, 5, 6};
-  else if (feedback_mode == 30) feedback_strategy = std::vector<uint32_t>{1, 3, 4, 5, 6};
-  else if (feedback_mode == 31) feedback_strategy = std::vector<uint32_t>{1, 2, 3, 4, 5, 6};
-
+  feedback_strategy = feedback_strategy_mask(feedback_mode);
 
   state = std::make_shared<QuantumCHPState>(system_size);
 
@@ -122,7 +92,11 @@ void SandpileCliffordSimulator::mzr(uint32_t i) {
         s += std::abs(entropy_surface1[i] - entropy_surface2[i]);
       }
 
-      interface_sampler.record_size(s);
+      if (avalanche_histogram) {
+        histogram.record(s);
+      } else {
+        interface_sampler.record_size(s);
+      }
     }
   }
 }
@@ -176,24 +150,6 @@ void SandpileCliffordSimulator::right_boundary() {
   }
 }
 
-uint32_t SandpileCliffordSimulator::get_shape(uint32_t s0, uint32_t s1, uint32_t s2) const {
-  int ds1 = s0 - s1;
-  int ds2 = s2 - s1;
-
-  if      ((ds1 == 0)  && (ds2 == 0))   return 1; // 0 0 0 (a)
-  else if ((ds1 == -1) && (ds2 == -1))  return 2; // 0 1 0 (b)
-  else if ((ds1 == 1)  && (ds2 == 1))   return 3; // 1 0 1 (c)
-  else if ((ds1 == 0)  && (ds2 == 1))   return 4; // 0 0 1 (d)
-  else if ((ds1 == 1)  && (ds2 == 0))   return 4; // 1 0 0
-  else if ((ds1 == 0)  && (ds2 == -1))  return 5; // 1 1 0 (e)
-  else if ((ds1 == -1) && (ds2 == 0))   return 5; // 0 1 1
-  else if ((ds1 == -1) && (ds2 == 1))   return 6; // 0 1 2 (f)
-  else if ((ds1 == 1)  && (ds2 == -1))  return 6; // 2 1 0
-  else { 
-    throw std::invalid_argument("Something has gone wrong with the entropy substrate."); 
-  }
-}
-
 void SandpileCliffordSimulator::feedback(uint32_t q) {
   uint32_t q0;
   uint32_t q2;
@@ -209,9 +165,9 @@ void SandpileCliffordSimulator::feedback(uint32_t q) {
   int s1 = state->cum_entanglement<int>(q);
   int s2 = state->cum_entanglement<int>(q2);
 
-  uint32_t shape = get_shape(s0, s1, s2);
+  uint32_t shape = surface_shape(s0, s1, s2);
 
-  if (std::count(feedback_strategy.begin(), feedback_strategy.end(), shape)) {
+  if (in_feedback_strategy(feedback_strategy, shape)) {
     unitary(q);
   } else {
     mzr(q);
@@ -249,6 +205,9 @@ SampleMap SandpileCliffordSimulator::take_samples() {
   std::vector<int> entropy_surface = state->get_entanglement<int>(2);
 
   interface_sampler.add_samples(samples, entropy_surface);
+  if (avalanche_histogram) {
+    histogram.add_samples(samples);
+  }
   if (sample_reduced_surface) {
     add_reduced_substrate_height_samples(samples, entropy_surface);
   }
@@ -260,7 +219,8 @@ SampleMap SandpileCliffordSimulator::take_samples() {
 template<>
 struct glz::meta<SandpileCliffordSimulator> {
   static constexpr auto value = glz::object(
-      "state", &SandpileCliffordSimulator::state
+      "state", &SandpileCliffordSimulator::state,
+      "histogram", &SandpileCliffordSimulator::histogram
       );
 };
 
@@ -3,6 +3,7 @@
 #include <Simulator.hpp>
 #include <CliffordState.h>
 #include <Samplers.h>
+#include <AvalancheHistogram.hpp>
 
 class SandpileCliffordSimulator : public Simulator {
 	private:
@@ -18,10 +19,12 @@ class SandpileCliffordSimulator : public Simulator {
 		uint32_t unitary_qubits;
 		uint32_t mzr_mode;
 		
-		std::vector<uint32_t> feedback_strategy;
+		uint32_t feedback_strategy;
 
 		bool start_sampling;
 		bool sample_avalanche_sizes;
+		bool avalanche_histogram;
+		AvalancheHistogram histogram;
 
     bool sample_reduced_surface;
 		
@@ -41,8 +44,6 @@ class SandpileCliffordSimulator : public Simulator {
 		
 		void timestep();
 
-		uint32_t get_shape(uint32_t s0, uint32_t s1, uint32_t s2) const;
-
     void add_reduced_substrate_height_samples(dataframe::SampleMap& samples, const std::vector<int>& surface) const;
 
 	public:
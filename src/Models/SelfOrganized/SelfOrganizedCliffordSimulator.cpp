@@ -53,6 +53,7 @@ SelfOrganizedCliffordSimulator::SelfOrganizedCliffordSimulator(ExperimentParams
 	initial_offset = false;
 
 	state = std::make_shared<QuantumGraphState>(system_size);
+	components = GraphComponents(system_size);
 	if (evolution_type == EvolutionType::QuantumAutomaton) { // quantum automaton circuit must be polarized
 		for (uint32_t i = 0; i < system_size; i++) {
 			state->h(i);
@@ -61,6 +62,7 @@ SelfOrganizedCliffordSimulator::SelfOrganizedCliffordSimulator(ExperimentParams
 }
 
 void SelfOrganizedCliffordSimulator::mzr(uint32_t q) {
+	components.invalidate();
 	state->mzr(q);
 	if (evolution_type == EvolutionType::QuantumAutomaton) {
 		state->h(q);
@@ -93,8 +95,19 @@ float SelfOrganizedCliffordSimulator::avg_dist() const {
 	}
 }
 
-float SelfOrganizedCliffordSimulator::max_component_size() const {
-	return state->graph.max_component_size();
+// Toggles edge (i, j) of the graph state; insertions are merged into the component index, deletions invalidate it
+void SelfOrganizedCliffordSimulator::toggle_edge(uint32_t i, uint32_t j) {
+	if (state->graph.contains_edge(i, j)) {
+		components.invalidate();
+	} else {
+		components.add_edge(i, j);
+	}
+
+	state->toggle_edge_gate(i, j);
+}
+
+float SelfOrganizedCliffordSimulator::max_component_size() {
+	return components.max_component_size(state->graph);
 }
 
 void SelfOrganizedCliffordSimulator::random_measure() {
@@ -140,6 +153,8 @@ void SelfOrganizedCliffordSimulator::mzr_feedback() {
 
 
 void SelfOrganizedCliffordSimulator::qa_timestep(bool offset, bool gate_type) {
+	components.invalidate();
+
 	for (uint32_t i = 0; i < system_size/2; i++) {
 		uint32_t qubit1 = offset ? (2*i + 1) % system_size : 2*i;
 		uint32_t qubit2 = offset ? (2*i + 2) % system_size : (2*i + 1) % system_size;
@@ -192,6 +207,7 @@ void SelfOrganizedCliffordSimulator::rc_timesteps(uint32_t num_steps) {
 			std::transform(offset_qubits.begin(), offset_qubits.end(), 
 						offset_qubits.begin(), [num_qubits, offset](uint32_t x) { return (x + offset) % num_qubits; } );
 			state->random_clifford(offset_qubits);
+			components.invalidate();
 		}
 
 		mzr_feedback();
@@ -206,8 +222,9 @@ void SelfOrganizedCliffordSimulator::graph_timesteps(uint32_t num_steps) {
 	for (uint32_t i = 0; i < system_size; i += 2) {
 		uint32_t j = (i + 1) % system_size;
 		if (!state->graph.contains_edge(i, j)) {
-			state->toggle_edge_gate(i, j);
+			toggle_edge(i, j);
 		} else {
+			components.invalidate();
 			state->graph.local_complement(i);
 			state->graph.local_complement(j);
 		}
@@ -216,8 +233,9 @@ void SelfOrganizedCliffordSimulator::graph_timesteps(uint32_t num_steps) {
 	for (uint32_t i = 1; i < system_size; i += 2) {
 		uint32_t j = (i + 1) % system_size;
 		if (!state->graph.contains_edge(i, j)) {
-			state->toggle_edge_gate(i, j);
+			toggle_edge(i, j);
 		} else {
+			components.invalidate();
 			state->graph.local_complement(i);
 			state->graph.local_complement(j);
 		}
@@ -227,7 +245,7 @@ void SelfOrganizedCliffordSimulator::graph_timesteps(uint32_t num_steps) {
 		// "measurement" step; with some probability, remove all edges incident on i
 		if (randf() < mzr_prob) {
 			for (auto const &j : state->graph.neighbors(i)) {
-				state->toggle_edge_gate(i, j);
+				toggle_edge(i, j);
 			}
 		}
 	}
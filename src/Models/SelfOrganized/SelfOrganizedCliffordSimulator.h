@@ -4,6 +4,8 @@
 #include <CliffordState.h>
 #include <Samplers.h>
 
+#include <GraphComponents.hpp>
+
 enum EvolutionType {
 	RandomClifford,
 	QuantumAutomaton,
@@ -38,13 +40,15 @@ class SelfOrganizedCliffordSimulator : public Simulator {
 
 		EntropySampler sampler;
 
-		
+		GraphComponents components;
+
 		uint32_t dist(int i, int j) const;
 		float avg_dist() const;
 
-		float max_component_size() const;
+		float max_component_size();
 
 		void mzr(uint32_t q);
+		void toggle_edge(uint32_t i, uint32_t j);
 		void mzr_feedback();
 
 		void qa_timestep(bool offset, bool gate_type);
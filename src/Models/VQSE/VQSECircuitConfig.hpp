@@ -85,9 +85,7 @@ class VQSECircuitConfig {
       QuantumCircuit trained_ansatz(num_qubits);
 
       for (uint32_t d = 1; d <= target_depth; d++) {
-        QuantumCircuit ansatz(num_qubits);
-        ansatz.append(trained_ansatz);    // Section which has already been bound
-        ansatz.append(prepare_ansatz(2)); // Variational section
+        QuantumCircuit ansatz = prepare_ansatz(2); // Variational section
         QuantumCircuit target_d = prepare_target_circuit_to_depth(target, d);
 
         outputs.push_back(randi() % 2);
@@ -97,11 +95,16 @@ class VQSECircuitConfig {
         target_state = Statevector(num_qubits);
         target_state.evolve(target_d);
 
+        // Checkpoint the state after the section which has already been bound, so that
+        // each cost evaluation only evolves through the variational section. Fidelities
+        // are unchanged since the frozen prefix is unitary.
+        target_state.evolve(trained_ansatz);
+
         std::vector<double> params = initialize_params(ansatz.num_params());
         vqse = VQSE(ansatz, 1, num_iterations_per_layer, hamiltonian_type, update_frequency, sampling_type, num_shots, optimizer);
         vqse.optimize(target_state, params, callback);
 
-        trained_ansatz = ansatz.bind_params(vqse.params);
+        trained_ansatz.append(ansatz.bind_params(vqse.params));
       }
 
       auto stop = std::chrono::high_resolution_clock::now();
@@ -9,6 +9,7 @@
 #include <Samplers.h>
 
 #include "Models.h"
+#include <PrefixEntropy.hpp>
 
 using namespace dataframe;
 using namespace dataframe::utils;
@@ -81,7 +82,421 @@ bool test_quantum_ising() {
   return true;
 }
 
+bool test_bitsliced_amplitude() {
+  ExperimentParams params;
+  params["k"] = static_cast<int>(2);
+  params["calculation_type"] = static_cast<int>(0);
+
+  HQCircuitConfig config(params);
+
+  // Compare against the explicit sum over every bitstring
+  for (uint32_t i = 0; i < 20; i++) {
+    BinaryPolynomial poly = config.generate_hq_polynomial();
+
+    uint64_t s = 1ull << poly.n;
+    double I = 0.0;
+    for (uint64_t z = 0; z < s; z++) {
+      I += std::pow(-1.0, poly.evaluate(BitString::from_bits(poly.n, z)));
+    }
+    I /= s;
+
+    double amplitude = config.calculate_amplitude(poly);
+    if (std::abs(amplitude - I) > 1e-10) {
+      std::cout << fmt::format("Bitsliced amplitude {} does not match explicit sum {}.\n", amplitude, I);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool test_gf2_factorization() {
+  for (uint32_t i = 0; i < 50; i++) {
+    size_t m = 1 + randi() % 100;
+    GF2Factorization factorization(m);
+    size_t num_words = factorization.num_words;
+
+    // Sparse matrices, so that rank-deficient cases are common
+    std::vector<uint64_t> A(m*num_words, 0);
+    BinaryMatrix B(m, m);
+    for (size_t r = 0; r < m; r++) {
+      for (size_t c = 0; c < m; c++) {
+        if (randf() < 2.0/m) {
+          GF2Factorization::flip_bit(A.data() + r*num_words, c);
+          B.set(r, c, 1);
+        }
+      }
+    }
+
+    factorization.factorize(A);
+    if (factorization.rank() != B.rank()) {
+      std::cout << fmt::format("GF2Factorization rank {} does not match {}.\n", factorization.rank(), B.rank());
+      return false;
+    }
+
+    for (uint32_t j = 0; j < 10; j++) {
+      std::vector<uint64_t> v(num_words, 0);
+      std::vector<bool> v_bits(m);
+      for (size_t c = 0; c < m; c++) {
+        if (randi() % 2) {
+          GF2Factorization::flip_bit(v.data(), c);
+          v_bits[c] = true;
+        }
+      }
+
+      bool in_col_space = factorization.in_col_space(v);
+      if (in_col_space != B.in_col_space(v_bits) || factorization.in_row_space(v) != B.in_row_space(v_bits)) {
+        std::cout << "GF2Factorization row or column space membership does not match.\n";
+        return false;
+      }
+
+      if (in_col_space) {
+        std::vector<uint64_t> x = factorization.solve(v);
+        for (size_t r = 0; r < m; r++) {
+          uint32_t parity = 0;
+          for (size_t w = 0; w < num_words; w++) {
+            parity += std::popcount(A[r*num_words + w] & x[w]);
+          }
+
+          if (bool(parity & 1) != v_bits[r]) {
+            std::cout << "GF2Factorization solution does not solve the system.\n";
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_blocked_surface() {
+  for (uint32_t i = 0; i < 20; i++) {
+    size_t L = 1 + randi() % 200;
+    std::vector<int> reference(L, 0);
+    BlockedSurface surface(reference);
+
+    for (uint32_t j = 0; j < 2000; j++) {
+      size_t a = randi() % L;
+      size_t b = randi() % (L + 1);
+      int v = int(randi() % 5) - 2;
+      if (randi() % 2) {
+        surface.add(a, v);
+        reference[a] += v;
+      } else {
+        size_t left = std::min(a, b);
+        size_t right = std::max(a, b);
+        surface.add(left, right, v);
+        for (size_t k = left; k < right; k++) {
+          reference[k] += v;
+        }
+      }
+
+      // Compare both searches from a random site against a linear scan
+      int h = reference[randi() % L];
+      size_t start = randi() % (L + 1);
+      int64_t last = -1;
+      for (size_t k = 0; k < start; k++) {
+        if (reference[k] <= h) {
+          last = k;
+        }
+      }
+      size_t first = L;
+      for (size_t k = L; k > start; k--) {
+        if (reference[k - 1] <= h) {
+          first = k - 1;
+        }
+      }
+
+      if (surface.last_at_most(start, h) != last || surface.first_at_most(start, h) != first || surface.to_vector() != reference) {
+        std::cout << "BlockedSurface does not match the reference surface.\n";
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Unit-capacity max-flow between vertex sets a and b of an undirected graph, by BFS augmentation from scratch
+static uint32_t reference_min_cut(uint32_t n, const std::vector<std::pair<uint32_t, uint32_t>>& edges, const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+  // Vertices n and n + 1 are the super source and sink
+  std::vector<std::vector<int>> capacity(n + 2, std::vector<int>(n + 2, 0));
+  for (auto const& [u, v] : edges) {
+    capacity[u][v]++;
+    capacity[v][u]++;
+  }
+  for (auto v : a) {
+    capacity[n][v] = n*n;
+  }
+  for (auto v : b) {
+    capacity[v][n + 1] = n*n;
+  }
+
+  uint32_t flow = 0;
+  while (true) {
+    std::vector<int64_t> parent(n + 2, -1);
+    parent[n] = n;
+    std::vector<uint32_t> queue = {n};
+    for (size_t head = 0; head < queue.size() && parent[n + 1] == -1; head++) {
+      uint32_t u = queue[head];
+      for (uint32_t w = 0; w < n + 2; w++) {
+        if (parent[w] == -1 && capacity[u][w] > 0) {
+          parent[w] = u;
+          queue.push_back(w);
+        }
+      }
+    }
+
+    if (parent[n + 1] == -1) {
+      return flow;
+    }
+
+    for (uint32_t w = n + 1; w != n; w = parent[w]) {
+      capacity[parent[w]][w]--;
+      capacity[w][parent[w]]++;
+    }
+    flow++;
+  }
+}
+
+bool test_incremental_min_cut() {
+  for (uint32_t i = 0; i < 50; i++) {
+    uint32_t width = 2 + randi() % 8;
+    IncrementalMinCut network(width);
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+
+    // Rows of width vertices, each joined to the row below as in MinCutSimulator, queried on the newest row
+    for (uint32_t t = 0; t < 10; t++) {
+      uint32_t d = network.num_vertices();
+      for (uint32_t j = 0; j < width; j++) {
+        network.add_vertex();
+      }
+
+      for (uint32_t j = 0; j < width; j++) {
+        for (auto k : {j, (j + 1) % width}) {
+          if (randf() < 0.7) {
+            network.add_edge(d + j, d - width + k);
+            edges.push_back({d + j, d - width + k});
+          }
+        }
+      }
+
+      // Contiguous subsystems against their complement, swept by one site at a time as the entropy sampler does
+      for (uint32_t left = 0; left < width; left++) {
+        for (uint32_t right = left + 1; right < width; right++) {
+          std::vector<uint32_t> a;
+          std::vector<uint32_t> b;
+          for (uint32_t j = 0; j < width; j++) {
+            ((j >= left && j < right) ? a : b).push_back(d + j);
+          }
+
+          uint32_t cut = network.min_cut(a, b);
+          uint32_t reference = reference_min_cut(network.num_vertices(), edges, a, b);
+          if (cut != reference) {
+            std::cout << fmt::format("IncrementalMinCut found a cut of {} instead of {}.\n", cut, reference);
+            return false;
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_prefix_entropy() {
+  for (uint32_t i = 0; i < 20; i++) {
+    uint32_t num_qubits = 2 + randi() % 40;
+    QuantumCHPState state(num_qubits);
+
+    // Random local circuit with measurements, so that the entropies are neither maximal nor zero
+    for (uint32_t t = 0; t < 4*num_qubits; t++) {
+      uint32_t q = randi() % (num_qubits - 1);
+      std::vector<uint32_t> qubits{q, q + 1};
+      state.random_clifford(qubits);
+      if (randf() < 0.1) {
+        state.mzr(randi() % num_qubits);
+      }
+    }
+
+    std::vector<int> entropies = prefix_entropies(state, num_qubits);
+    for (uint32_t q = 0; q <= num_qubits; q++) {
+      std::vector<uint32_t> prefix(q);
+      std::iota(prefix.begin(), prefix.end(), 0);
+      double s = state.entanglement(prefix, 2);
+      if (std::abs(s - entropies[q]) > 1e-8) {
+        std::cout << fmt::format("Prefix entropy {} of [0, {}) does not match {}.\n", entropies[q], q, s);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_partner_weight_tree() {
+  for (uint32_t i = 0; i < 10; i++) {
+    uint32_t num_nodes = 2 + randi() % 30;
+    double relaxation_time = 1.0 + 10.0*randf();
+
+    std::vector<std::vector<double>> affinity(num_nodes, std::vector<double>(num_nodes));
+    std::vector<std::vector<uint64_t>> last_contact(num_nodes, std::vector<uint64_t>(num_nodes, 0));
+    std::vector<std::vector<bool>> active(num_nodes, std::vector<bool>(num_nodes, true));
+    for (uint32_t a = 0; a < num_nodes; a++) {
+      for (uint32_t b = 0; b < num_nodes; b++) {
+        affinity[a][b] = randf();
+      }
+    }
+
+    PartnerWeightTree tree(num_nodes, relaxation_time);
+    tree.build([&](uint32_t a, uint32_t b) { return affinity[a][b]; }, [](uint32_t, uint32_t) { return 0; });
+
+    // Long enough for the reference time to be rebased several times
+    uint64_t now = 0;
+    for (uint32_t t = 0; t < 100*static_cast<uint32_t>(relaxation_time) + 200; t++) {
+      now += 1 + randi() % 3;
+      tree.advance(now);
+
+      for (uint32_t k = 0; k < num_nodes; k++) {
+        uint32_t a = randi() % num_nodes;
+        uint32_t b = randi() % num_nodes;
+        if (randf() < 0.2) {
+          active[a][b] = !active[a][b];
+          tree.set_active(a, b, affinity[a][b], last_contact[a][b], active[a][b]);
+        } else if (active[a][b]) {
+          tree.contact(a, b, affinity[a][b], last_contact[a][b], now);
+          last_contact[a][b] = now;
+        }
+      }
+
+      // Every partner weight, through the cumulative weights which sample bisects
+      for (uint32_t a = 0; a < num_nodes; a++) {
+        std::vector<double> weights(num_nodes, 0.0);
+        double total = 0.0;
+        for (uint32_t b = 0; b < num_nodes; b++) {
+          if (active[a][b]) {
+            weights[b] = affinity[a][b]*(1.0 - std::exp(-double(now - last_contact[a][b])/relaxation_time));
+          }
+          total += weights[b];
+        }
+
+        double tolerance = 1e-9*(1.0 + total);
+        if (std::abs(tree.total(a) - total) > tolerance) {
+          std::cout << fmt::format("PartnerWeightTree has a total weight of {} instead of {}.\n", tree.total(a), total);
+          return false;
+        }
+
+        double cumulative = 0.0;
+        for (uint32_t b = 0; b < num_nodes; b++) {
+          if (weights[b] > 2*tolerance) {
+            uint32_t lower = tree.sample(a, cumulative + tolerance);
+            uint32_t upper = tree.sample(a, cumulative + weights[b] - tolerance);
+            if (lower != b || upper != b) {
+              std::cout << fmt::format("PartnerWeightTree drew partners {} and {} inside the weight of partner {}.\n", lower, upper, b);
+              return false;
+            }
+          }
+          cumulative += weights[b];
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_stabilizer_rows() {
+  for (uint32_t i = 0; i < 20; i++) {
+    uint32_t num_qubits = 2 + randi() % 70;
+    QuantumCHPState state(num_qubits);
+
+    for (uint32_t t = 0; t < 2*num_qubits; t++) {
+      std::vector<uint32_t> qubits{randi() % num_qubits, randi() % num_qubits};
+      if (qubits[0] != qubits[1]) {
+        state.random_clifford(qubits);
+      }
+      if (randf() < 0.1) {
+        state.mzr(randi() % num_qubits);
+      }
+    }
+
+    // Random partitions, as drawn by NetworkCliffordSimulator
+    StabilizerRows stabilizers(state);
+    for (uint32_t k = 0; k < 10; k++) {
+      std::vector<uint32_t> subsystem;
+      for (uint32_t j = 0; j < num_qubits; j++) {
+        if (randf() < 0.5) {
+          subsystem.push_back(j);
+        }
+      }
+
+      int s = stabilizers.entropy(subsystem);
+      double reference = state.entanglement(subsystem, 2);
+      if (std::abs(s - reference) > 1e-8) {
+        std::cout << fmt::format("Packed entropy {} of a random partition does not match {}.\n", s, reference);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool test_system_entropy() {
+  for (uint32_t i = 0; i < 20; i++) {
+    uint32_t system_size = 2 + randi() % 30;
+    uint32_t num_qubits = system_size + 1 + randi() % 40;
+    auto state = std::make_shared<QuantumCHPState>(num_qubits);
+    SystemEntropyState system_state(state, system_size);
+
+    for (uint32_t t = 0; t < 3; t++) {
+      // Random circuit coupling the system to the environment, so that the reduced state is mixed
+      for (uint32_t k = 0; k < num_qubits; k++) {
+        std::vector<uint32_t> qubits{randi() % num_qubits, randi() % num_qubits};
+        if (qubits[0] != qubits[1]) {
+          state->random_clifford(qubits);
+        }
+        if (randf() < 0.05) {
+          state->mzr(randi() % num_qubits);
+        }
+      }
+      system_state.update();
+
+      for (uint32_t k = 0; k < 10; k++) {
+        std::vector<uint32_t> subsystem;
+        for (uint32_t j = 0; j < system_size; j++) {
+          if (randf() < 0.5) {
+            subsystem.push_back(j);
+          }
+        }
+
+        double s = system_state.entanglement(subsystem, 2);
+        double reference = state->entanglement(subsystem, 2);
+        if (std::abs(s - reference) > 1e-8) {
+          std::cout << fmt::format("System entropy {} does not match {} with {} environment qubits.\n", s, reference, num_qubits - system_size);
+          return false;
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
 int main() {
   test_mps();
   //test_quantum_ising();
+
+  bool passed = true;
+  passed &= test_bitsliced_amplitude();
+  passed &= test_gf2_factorization();
+  passed &= test_blocked_surface();
+  passed &= test_incremental_min_cut();
+  passed &= test_prefix_entropy();
+  passed &= test_partner_weight_tree();
+  passed &= test_stabilizer_rows();
+  passed &= test_system_entropy();
+
+  return passed ? 0 : 1;
 }